@@ -0,0 +1,148 @@
+#ifndef __INET_COLUMNARFILE_H
+#define __INET_COLUMNARFILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <errno.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "INETDefs.h"
+#include "cconfigurationex.h"
+
+//
+// Building blocks of the columnar result files written by
+// ColumnarOutputVectorManager (.cvec) and ColumnarOutputScalarManager (.csca).
+//
+// A file starts with an 8-byte magic and ends with a footer
+//
+//     uint64 indexOffset, uint32 indexLength, "CIDX"
+//
+// (little endian) that locates the index, so a reader can memory-map the file,
+// read the footer and jump directly to the columns it needs. Integers in
+// the index and in the columns are LEB128 varints (signed ones zigzag
+// encoded), doubles are 8 bytes little endian. See tools/colreader.py.
+//
+
+#define COLUMNAR_FOOTER_MAGIC   "CIDX"
+
+/**
+ * Byte buffer with the encoders of the columnar format.
+ */
+class ColumnarBuffer
+{
+  protected:
+    std::string bytes;
+
+  public:
+    void clear() { bytes.clear(); }
+    size_t size() const { return bytes.size(); }
+    const char *data() const { return bytes.data(); }
+
+    void putByte(unsigned char b) { bytes += (char)b; }
+
+    void putVarint(uint64 value)
+    {
+        while (value >= 0x80)
+        {
+            bytes += (char)((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        bytes += (char)value;
+    }
+
+    void putSignedVarint(int64 value) { putVarint(((uint64)value << 1) ^ (uint64)(value >> 63)); }
+
+    void putFixed(uint64 value, int numBytes)
+    {
+        for (int i = 0; i < numBytes; i++, value >>= 8)
+            bytes += (char)(value & 0xff);
+    }
+
+    void putDouble(double value)
+    {
+        uint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putFixed(bits, 8);
+    }
+
+    void putString(const char *s)
+    {
+        size_t n = strlen(s);
+        putVarint(n);
+        bytes.append(s, n);
+    }
+};
+
+/**
+ * Creates the directory of the file name, if needed (like mkdir -p).
+ */
+inline void createDirectoryOf(const std::string& fileName)
+{
+    for (size_t pos = fileName.find_first_of("/\\", 1); pos != std::string::npos; pos = fileName.find_first_of("/\\", pos + 1))
+    {
+        std::string dir = fileName.substr(0, pos);
+#ifdef _WIN32
+        int ret = _mkdir(dir.c_str());
+#else
+        int ret = mkdir(dir.c_str(), 0755);
+#endif
+        if (ret != 0 && errno != EEXIST)
+            throw cRuntimeError("Cannot create directory '%s'", dir.c_str());
+    }
+}
+
+/**
+ * Appends the index and the footer; the file must be positioned at its end,
+ * at byte offset indexOffset.
+ */
+inline void writeColumnarIndex(FILE *f, uint64 indexOffset, const ColumnarBuffer& index)
+{
+    ColumnarBuffer footer;
+    footer.putFixed(indexOffset, 8);
+    footer.putFixed(index.size(), 4);
+    if (fwrite(index.data(), 1, index.size(), f) != index.size() ||
+        fwrite(footer.data(), 1, footer.size(), f) != footer.size() ||
+        fwrite(COLUMNAR_FOOTER_MAGIC, 1, 4, f) != 4)
+        throw cRuntimeError("Cannot write the index of a columnar result file");
+}
+
+/**
+ * Appends the run attributes (run id, configuration, iteration variables...)
+ * to the index.
+ */
+inline void putRunAttributes(ColumnarBuffer& index)
+{
+    static const char *names[] = { "runid", "configname", "runnumber", "repetition", "iterationvars", "iterationvars2" };
+    const int n = sizeof(names) / sizeof(names[0]);
+
+    cConfigurationEx *config = ev.getConfigEx();
+    const char *values[n];
+    int numAttributes = 1;    // simtime-scale
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = config->getVariable(names[i]);
+        if (values[i])
+            numAttributes++;
+    }
+
+    index.putVarint(numAttributes);
+    char scale[16];
+    sprintf(scale, "%d", SimTime::getScaleExp());
+    index.putString("simtime-scale");
+    index.putString(scale);
+    for (int i = 0; i < n; i++)
+    {
+        if (!values[i])
+            continue;
+        index.putString(names[i]);
+        index.putString(values[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "ColumnarOutputScalarManager.h"
+
+#define SCALAR_FILE_MAGIC   "OMNCSCA2"
+
+Register_Class(ColumnarOutputScalarManager);
+
+Register_PerRunConfigOption(CFGID_COLUMNAR_SCALAR_FILE, "columnar-scalar-file", CFG_FILENAME, "${resultdir}/${configname}-${runnumber}.csca", "Output file of ColumnarOutputScalarManager.");
+
+ColumnarOutputScalarManager::ColumnarOutputScalarManager()
+{
+    inRun = false;
+}
+
+void ColumnarOutputScalarManager::startRun()
+{
+    fileName = ev.getConfig()->getAsFilename(CFGID_COLUMNAR_SCALAR_FILE);
+    remove(fileName.c_str());
+
+    moduleIndex.clear();
+    nameIndex.clear();
+    moduleNames.clear();
+    names.clear();
+    moduleColumn.clear();
+    nameColumn.clear();
+    valueColumn.clear();
+    attributeRecords.clear();
+    histogramRecords.clear();
+    inRun = true;
+}
+
+void ColumnarOutputScalarManager::endRun()
+{
+    if (!inRun)
+        return;
+    inRun = false;
+    if (!valueColumn.empty())
+        writeFile();
+}
+
+int ColumnarOutputScalarManager::intern(std::map<std::string, int>& index, std::vector<std::string>& strings, const std::string& s)
+{
+    std::map<std::string, int>::iterator it = index.find(s);
+    if (it != index.end())
+        return it->second;
+    int i = strings.size();
+    strings.push_back(s);
+    index[s] = i;
+    return i;
+}
+
+void ColumnarOutputScalarManager::add(const std::string& moduleName, const std::string& name, double value)
+{
+    moduleColumn.push_back(intern(moduleIndex, moduleNames, moduleName));
+    nameColumn.push_back(intern(nameIndex, names, name));
+    valueColumn.push_back(value);
+}
+
+void ColumnarOutputScalarManager::addAttributes(const std::string& moduleName, const std::string& name, opp_string_map *attributes)
+{
+    if (!attributes || attributes->empty())
+        return;
+    AttributeRecord record;
+    record.module = intern(moduleIndex, moduleNames, moduleName);
+    record.name = intern(nameIndex, names, name);
+    for (opp_string_map::iterator it = attributes->begin(); it != attributes->end(); ++it)
+        record.attributes[it->first.c_str()] = it->second.c_str();
+    attributeRecords.push_back(record);
+}
+
+void ColumnarOutputScalarManager::addHistogram(const std::string& moduleName, const std::string& name, cDensityEstBase *histogram)
+{
+    if (!histogram->isTransformed())
+        histogram->transform();
+    int n = histogram->getNumCells();
+    if (n <= 0)
+        return;
+
+    HistogramRecord record;
+    record.module = intern(moduleIndex, moduleNames, moduleName);
+    record.name = intern(nameIndex, names, name);
+    record.counts.push_back(histogram->getUnderflowCell());
+    for (int i = 0; i < n; i++)
+    {
+        record.edges.push_back(histogram->getBasepoint(i));
+        record.counts.push_back(histogram->getCellValue(i));
+    }
+    record.edges.push_back(histogram->getBasepoint(n));
+    record.counts.push_back(histogram->getOverflowCell());
+    histogramRecords.push_back(record);
+}
+
+void ColumnarOutputScalarManager::recordScalar(cComponent *component, const char *name, double value, opp_string_map *attributes)
+{
+    if (!inRun)
+        throw cRuntimeError("No scalars can be recorded outside the run");
+
+    std::string moduleName = component->getFullPath();
+    std::string objectName = moduleName + "." + name;
+    const char *recording = ev.getConfig()->getPerObjectConfigValue(objectName.c_str(), "scalar-recording");
+    if (recording && strcmp(recording, "false") == 0)
+        return;
+    add(moduleName, name, value);
+    addAttributes(moduleName, name, attributes);
+}
+
+void ColumnarOutputScalarManager::recordStatistic(cComponent *component, const char *name, cStatistic *statistic, opp_string_map *attributes)
+{
+    if (!inRun)
+        throw cRuntimeError("No scalars can be recorded outside the run");
+    if (!name)
+        name = statistic->getFullName();
+    if (!name || !*name)
+        throw cRuntimeError("recordStatistic(): name of the statistic object must not be empty");
+
+    std::string moduleName = component->getFullPath();
+    std::string objectName = moduleName + "." + name;
+    const char *recording = ev.getConfig()->getPerObjectConfigValue(objectName.c_str(), "scalar-recording");
+    if (recording && strcmp(recording, "false") == 0)
+        return;
+
+    std::string prefix = std::string(name) + ":";
+    add(moduleName, prefix + "count", statistic->getCount());
+    add(moduleName, prefix + "mean", statistic->getMean());
+    add(moduleName, prefix + "stddev", statistic->getStddev());
+    add(moduleName, prefix + "min", statistic->getMin());
+    add(moduleName, prefix + "max", statistic->getMax());
+    add(moduleName, prefix + "sum", statistic->getSum());
+    addAttributes(moduleName, name, attributes);
+
+    cDensityEstBase *histogram = dynamic_cast<cDensityEstBase *>(statistic);
+    if (histogram)
+        addHistogram(moduleName, name, histogram);
+}
+
+void ColumnarOutputScalarManager::writeFile()
+{
+    createDirectoryOf(fileName);
+    FILE *f = fopen(fileName.c_str(), "wb");
+    if (!f)
+        throw cRuntimeError("Cannot open output scalar file '%s'", fileName.c_str());
+
+    // columns, one after the other: module indices, name indices, values
+    ColumnarBuffer columns[3];
+    for (unsigned int i = 0; i < valueColumn.size(); i++)
+    {
+        columns[0].putVarint(moduleColumn[i]);
+        columns[1].putVarint(nameColumn[i]);
+        columns[2].putDouble(valueColumn[i]);
+    }
+
+    uint64 offset = 8;
+    ColumnarBuffer index;
+    putRunAttributes(index);
+    index.putVarint(moduleNames.size());
+    for (unsigned int i = 0; i < moduleNames.size(); i++)
+        index.putString(moduleNames[i].c_str());
+    index.putVarint(names.size());
+    for (unsigned int i = 0; i < names.size(); i++)
+        index.putString(names[i].c_str());
+    index.putVarint(valueColumn.size());
+    for (int i = 0; i < 3; i++)
+    {
+        index.putVarint(offset);
+        index.putVarint(columns[i].size());
+        offset += columns[i].size();
+    }
+
+    // attributes: module, name, key/value pairs
+    index.putVarint(attributeRecords.size());
+    for (unsigned int i = 0; i < attributeRecords.size(); i++)
+    {
+        const AttributeRecord& record = attributeRecords[i];
+        index.putVarint(record.module);
+        index.putVarint(record.name);
+        index.putVarint(record.attributes.size());
+        for (std::map<std::string, std::string>::const_iterator it = record.attributes.begin(); it != record.attributes.end(); ++it)
+        {
+            index.putString(it->first.c_str());
+            index.putString(it->second.c_str());
+        }
+    }
+
+    // histograms: module, name, number of cells, cell edges, counts
+    // (underflow, cells, overflow)
+    index.putVarint(histogramRecords.size());
+    for (unsigned int i = 0; i < histogramRecords.size(); i++)
+    {
+        const HistogramRecord& record = histogramRecords[i];
+        index.putVarint(record.module);
+        index.putVarint(record.name);
+        index.putVarint(record.edges.size() - 1);
+        for (unsigned int j = 0; j < record.edges.size(); j++)
+            index.putDouble(record.edges[j]);
+        for (unsigned int j = 0; j < record.counts.size(); j++)
+            index.putDouble(record.counts[j]);
+    }
+
+    bool ok = fwrite(SCALAR_FILE_MAGIC, 1, 8, f) == 8;
+    for (int i = 0; i < 3 && ok; i++)
+        ok = fwrite(columns[i].data(), 1, columns[i].size(), f) == columns[i].size();
+    if (!ok)
+    {
+        fclose(f);
+        throw cRuntimeError("Cannot write output scalar file '%s'", fileName.c_str());
+    }
+    writeColumnarIndex(f, offset, index);
+    fclose(f);
+}
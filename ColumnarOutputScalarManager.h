@@ -0,0 +1,82 @@
+#ifndef __INET_COLUMNAROUTPUTSCALARMANAGER_H
+#define __INET_COLUMNAROUTPUTSCALARMANAGER_H
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "INETDefs.h"
+
+#include "ColumnarFile.h"
+
+/**
+ * Output scalar manager that writes the scalars of a run as three columns
+ * (module, name, value) of a binary columnar file (.csca), the counterpart
+ * of ColumnarOutputVectorManager. Selected in the ini file:
+ *
+ * <pre>
+ * outputscalarmanager-class = "ColumnarOutputScalarManager"
+ * columnar-scalar-file = "${resultdir}/${configname}-${runnumber}.csca"
+ * </pre>
+ *
+ * Module and scalar names are stored once in string tables and referenced
+ * by index from the columns. Statistics (recordStatistic(), e.g.
+ * cStdDev::recordAs()) are stored as the scalars "<name>:count", ":mean",
+ * ":stddev", ":min", ":max" and ":sum"; histograms (cDensityEstBase) also
+ * keep their bins. Attributes passed with a scalar or statistic (unit,
+ * title...) are stored in the index under the module and the scalar or
+ * statistic name. The file is written at the end of the run;
+ * scalar-recording is honoured.
+ */
+class INET_API ColumnarOutputScalarManager : public cOutputScalarManager
+{
+  protected:
+    std::string fileName;
+    bool inRun;
+
+    std::map<std::string, int> moduleIndex, nameIndex;
+    std::vector<std::string> moduleNames, names;
+
+    // columns
+    std::vector<int> moduleColumn;
+    std::vector<int> nameColumn;
+    std::vector<double> valueColumn;
+
+    // attributes of a scalar or statistic
+    struct AttributeRecord
+    {
+        int module;
+        int name;
+        std::map<std::string, std::string> attributes;
+    };
+    std::vector<AttributeRecord> attributeRecords;
+
+    // bins of a histogram: numCells+1 edges; underflow, cells, overflow
+    struct HistogramRecord
+    {
+        int module;
+        int name;
+        std::vector<double> edges;
+        std::vector<double> counts;
+    };
+    std::vector<HistogramRecord> histogramRecords;
+
+  protected:
+    static int intern(std::map<std::string, int>& index, std::vector<std::string>& strings, const std::string& s);
+    virtual void add(const std::string& moduleName, const std::string& name, double value);
+    virtual void addAttributes(const std::string& moduleName, const std::string& name, opp_string_map *attributes);
+    virtual void addHistogram(const std::string& moduleName, const std::string& name, cDensityEstBase *histogram);
+    virtual void writeFile();
+
+  public:
+    ColumnarOutputScalarManager();
+
+    virtual void startRun();
+    virtual void endRun();
+    virtual void recordScalar(cComponent *component, const char *name, double value, opp_string_map *attributes = NULL);
+    virtual void recordStatistic(cComponent *component, const char *name, cStatistic *statistic, opp_string_map *attributes = NULL);
+    virtual void flush() {}
+    virtual const char *getFileName() const { return fileName.c_str(); }
+};
+
+#endif
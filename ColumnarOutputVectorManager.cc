@@ -0,0 +1,301 @@
+#include <math.h>
+
+#include "ColumnarOutputVectorManager.h"
+
+#define VECTOR_FILE_MAGIC   "OMNCVEC1"
+
+Register_Class(ColumnarOutputVectorManager);
+
+Register_PerRunConfigOption(CFGID_COLUMNAR_VECTOR_FILE, "columnar-vector-file", CFG_FILENAME, "${resultdir}/${configname}-${runnumber}.cvec", "Output file of ColumnarOutputVectorManager.");
+Register_GlobalConfigOption(CFGID_COLUMNAR_VECTOR_CHUNK_SIZE, "columnar-vector-chunk-size", CFG_INT, "4096", "Number of samples per chunk in the files of ColumnarOutputVectorManager.");
+
+ColumnarOutputVectorManager::ColumnarOutputVectorManager()
+{
+    f = NULL;
+    fileOffset = 0;
+    chunkSize = 4096;
+    inRun = false;
+}
+
+ColumnarOutputVectorManager::~ColumnarOutputVectorManager()
+{
+    closeFile();
+    for (unsigned int i = 0; i < vectors.size(); i++)
+        delete vectors[i];
+}
+
+void ColumnarOutputVectorManager::openFile()
+{
+    createDirectoryOf(fileName);
+    f = fopen(fileName.c_str(), "wb");
+    if (!f)
+        throw cRuntimeError("Cannot open output vector file '%s'", fileName.c_str());
+    fwrite(VECTOR_FILE_MAGIC, 1, 8, f);
+    fileOffset = 8;
+}
+
+void ColumnarOutputVectorManager::closeFile()
+{
+    if (f)
+    {
+        fclose(f);
+        f = NULL;
+    }
+}
+
+void ColumnarOutputVectorManager::startRun()
+{
+    closeFile();
+    for (unsigned int i = 0; i < vectors.size(); i++)
+    {
+        // vectors that survive from a previous run start empty
+        vectors[i]->times.clear();
+        vectors[i]->values.clear();
+        vectors[i]->chunks.clear();
+    }
+
+    fileName = ev.getConfig()->getAsFilename(CFGID_COLUMNAR_VECTOR_FILE);
+    chunkSize = ev.getConfig()->getAsInt(CFGID_COLUMNAR_VECTOR_CHUNK_SIZE);
+    if (chunkSize < 1)
+        throw cRuntimeError("columnar-vector-chunk-size must be positive");
+    remove(fileName.c_str());
+    inRun = true;
+}
+
+void ColumnarOutputVectorManager::endRun()
+{
+    if (!inRun)
+        return;
+    inRun = false;
+
+    // the file is only created if something was recorded, like the .vec file
+    if (f)
+    {
+        for (unsigned int i = 0; i < vectors.size(); i++)
+            if (!vectors[i]->times.empty())
+                writeChunk(vectors[i]);
+        writeIndex();
+        closeFile();
+    }
+
+    // deregistered vectors were only kept for the index
+    std::vector<Vector *> live;
+    for (unsigned int i = 0; i < vectors.size(); i++)
+    {
+        if (vectors[i]->deregistered)
+            delete vectors[i];
+        else
+        {
+            vectors[i]->chunks.clear();
+            live.push_back(vectors[i]);
+        }
+    }
+    vectors.swap(live);
+}
+
+void *ColumnarOutputVectorManager::registerVector(const char *modulename, const char *vectorname)
+{
+    Vector *vector = new Vector();
+    vector->id = vectors.size();
+    vector->moduleName = modulename;
+    vector->vectorName = vectorname;
+    vector->deregistered = false;
+
+    std::string objectName = vector->moduleName + "." + vector->vectorName;
+    const char *recording = ev.getConfig()->getPerObjectConfigValue(objectName.c_str(), "vector-recording");
+    vector->enabled = !recording || strcmp(recording, "false") != 0;
+
+    vectors.push_back(vector);
+    return vector;
+}
+
+void ColumnarOutputVectorManager::deregisterVector(void *vechandle)
+{
+    Vector *vector = (Vector *)vechandle;
+    if (!inRun)
+    {
+        for (unsigned int i = 0; i < vectors.size(); i++)
+        {
+            if (vectors[i] == vector)
+            {
+                vectors.erase(vectors.begin() + i);
+                break;
+            }
+        }
+        delete vector;
+        return;
+    }
+
+    if (!vector->times.empty())
+        writeChunk(vector);
+    vector->deregistered = true;
+}
+
+void ColumnarOutputVectorManager::setVectorAttribute(void *vechandle, const char *name, const char *value)
+{
+    Vector *vector = (Vector *)vechandle;
+    vector->attributes.push_back(std::make_pair(std::string(name), std::string(value)));
+}
+
+bool ColumnarOutputVectorManager::record(void *vechandle, simtime_t t, double value)
+{
+    Vector *vector = (Vector *)vechandle;
+    if (!vector->enabled || !inRun)
+        return false;
+
+    if (vector->times.empty() && vector->times.capacity() < (size_t)chunkSize)
+    {
+        vector->times.reserve(chunkSize);
+        vector->values.reserve(chunkSize);
+    }
+    vector->times.push_back(t.raw());
+    vector->values.push_back(value);
+    if ((int)vector->times.size() >= chunkSize)
+        writeChunk(vector);
+    return true;
+}
+
+void ColumnarOutputVectorManager::writeChunk(Vector *vector)
+{
+    if (!f)
+        openFile();
+
+    const std::vector<int64>& times = vector->times;
+    const std::vector<double>& values = vector->values;
+    int n = times.size();
+
+    Chunk chunk;
+    chunk.offset = fileOffset;
+    chunk.count = n;
+    chunk.firstTime = times.front();
+    chunk.lastTime = times.back();
+    chunk.minValue = chunk.maxValue = values[0];
+    chunk.sum = 0;
+
+    // times: first value, then delta of deltas (periodic samples take one byte)
+    timeColumn.clear();
+    int64 prevTime = 0, prevDelta = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int64 delta = times[i] - prevTime;
+        timeColumn.putSignedVarint(i == 0 ? times[i] : delta - prevDelta);
+        prevDelta = i == 0 ? 0 : delta;
+        prevTime = times[i];
+    }
+
+    bool integral = true;
+    for (int i = 0; i < n; i++)
+    {
+        double v = values[i];
+        if (v < chunk.minValue)
+            chunk.minValue = v;
+        if (v > chunk.maxValue)
+            chunk.maxValue = v;
+        chunk.sum += v;
+        if (integral && !(floor(v) == v && fabs(v) < 9007199254740992.0))    // 2^53; false for NaN
+            integral = false;
+    }
+
+    valueColumn.clear();
+    if (integral)
+    {
+        chunk.valueEncoding = VALUES_INTEGER;
+        int64 prev = 0;
+        for (int i = 0; i < n; i++)
+        {
+            int64 v = (int64)values[i];
+            valueColumn.putSignedVarint(v - prev);
+            prev = v;
+        }
+    }
+    else
+    {
+        chunk.valueEncoding = VALUES_XOR;
+        uint64 prev = 0;
+        for (int i = 0; i < n; i++)
+        {
+            uint64 bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            // similar values share sign, exponent and the high mantissa bits, and
+            // short mantissas end in zeros: only the bytes in between are stored,
+            // after a byte with the number of leading (high nibble) and trailing
+            // zero bytes
+            uint64 x = bits ^ prev;
+            prev = bits;
+            if (x == 0)
+            {
+                valueColumn.putByte(0x80);
+                continue;
+            }
+            int leading = 0, trailing = 0;
+            while (!(x >> (56 - 8 * leading) & 0xff))
+                leading++;
+            while (!(x >> (8 * trailing) & 0xff))
+                trailing++;
+            valueColumn.putByte(leading << 4 | trailing);
+            valueColumn.putFixed(x >> (8 * trailing), 8 - leading - trailing);
+        }
+    }
+
+    chunk.timeBytes = timeColumn.size();
+    chunk.valueBytes = valueColumn.size();
+    if (fwrite(timeColumn.data(), 1, timeColumn.size(), f) != timeColumn.size() ||
+        fwrite(valueColumn.data(), 1, valueColumn.size(), f) != valueColumn.size())
+        throw cRuntimeError("Cannot write output vector file '%s'", fileName.c_str());
+    fileOffset += chunk.timeBytes + chunk.valueBytes;
+
+    vector->chunks.push_back(chunk);
+    vector->times.clear();
+    vector->values.clear();
+}
+
+void ColumnarOutputVectorManager::writeIndex()
+{
+    ColumnarBuffer index;
+    putRunAttributes(index);
+
+    int numVectors = 0;
+    for (unsigned int i = 0; i < vectors.size(); i++)
+        if (!vectors[i]->chunks.empty())
+            numVectors++;
+
+    index.putVarint(numVectors);
+    for (unsigned int i = 0; i < vectors.size(); i++)
+    {
+        const Vector *vector = vectors[i];
+        if (vector->chunks.empty())
+            continue;
+        index.putVarint(vector->id);
+        index.putString(vector->moduleName.c_str());
+        index.putString(vector->vectorName.c_str());
+        index.putVarint(vector->attributes.size());
+        for (unsigned int j = 0; j < vector->attributes.size(); j++)
+        {
+            index.putString(vector->attributes[j].first.c_str());
+            index.putString(vector->attributes[j].second.c_str());
+        }
+        index.putVarint(vector->chunks.size());
+        for (unsigned int j = 0; j < vector->chunks.size(); j++)
+        {
+            const Chunk& chunk = vector->chunks[j];
+            index.putVarint(chunk.offset);
+            index.putVarint(chunk.count);
+            index.putVarint(chunk.timeBytes);
+            index.putVarint(chunk.valueBytes);
+            index.putByte(chunk.valueEncoding);
+            index.putSignedVarint(chunk.firstTime);
+            index.putSignedVarint(chunk.lastTime);
+            index.putDouble(chunk.minValue);
+            index.putDouble(chunk.maxValue);
+            index.putDouble(chunk.sum);
+        }
+    }
+
+    writeColumnarIndex(f, fileOffset, index);
+}
+
+void ColumnarOutputVectorManager::flush()
+{
+    if (f)
+        fflush(f);
+}
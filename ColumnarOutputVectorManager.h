@@ -0,0 +1,92 @@
+#ifndef __INET_COLUMNAROUTPUTVECTORMANAGER_H
+#define __INET_COLUMNAROUTPUTVECTORMANAGER_H
+
+#include <vector>
+#include <string>
+
+#include "INETDefs.h"
+
+#include "ColumnarFile.h"
+
+/**
+ * Output vector manager that writes each run to one binary columnar file
+ * (.cvec) instead of the text .vec/.vci pair. Selected in the ini file:
+ *
+ * <pre>
+ * outputvectormanager-class = "ColumnarOutputVectorManager"
+ * columnar-vector-file = "${resultdir}/${configname}-${runnumber}.cvec"
+ * columnar-vector-chunk-size = 4096
+ * </pre>
+ *
+ * The samples of every vector are buffered and written in chunks of
+ * columnar-vector-chunk-size samples. In a chunk the time column (raw
+ * simtime ticks, delta-of-delta, zigzag varints) precedes the value column;
+ * values are delta encoded varints if all of them are integers, otherwise
+ * the bits of each double XOR the previous one, stripped of their leading
+ * and trailing zero bytes. At the end of the run an index is appended with
+ * the run attributes, the vectors (module, name, attributes) and the
+ * directory of their chunks (file offset, column sizes, count, time range,
+ * min, max and sum). A reader can therefore scan
+ * one column of one vector, or get the count/mean/min/max of a vector from
+ * the index alone, without touching the rest of the file.
+ *
+ * vector-recording is honoured; vector-recording-intervals is not.
+ */
+class INET_API ColumnarOutputVectorManager : public cOutputVectorManager
+{
+  protected:
+    struct Chunk
+    {
+        uint64 offset;
+        int count;
+        int timeBytes;
+        int valueBytes;
+        int valueEncoding;          // VALUES_INTEGER or VALUES_XOR
+        int64 firstTime, lastTime;  // raw simtime
+        double minValue, maxValue, sum;
+    };
+
+    struct Vector
+    {
+        int id;
+        std::string moduleName;
+        std::string vectorName;
+        std::vector<std::pair<std::string, std::string> > attributes;
+        bool enabled;
+        bool deregistered;          // kept until the end of the run for the index
+        std::vector<int64> times;   // samples of the chunk being filled
+        std::vector<double> values;
+        std::vector<Chunk> chunks;
+    };
+
+    enum { VALUES_INTEGER = 0, VALUES_XOR = 1 };
+
+    std::vector<Vector *> vectors;
+    std::string fileName;
+    FILE *f;
+    uint64 fileOffset;
+    int chunkSize;
+    bool inRun;
+    ColumnarBuffer timeColumn, valueColumn;
+
+  protected:
+    virtual void openFile();
+    virtual void closeFile();
+    virtual void writeChunk(Vector *vector);
+    virtual void writeIndex();
+
+  public:
+    ColumnarOutputVectorManager();
+    virtual ~ColumnarOutputVectorManager();
+
+    virtual void startRun();
+    virtual void endRun();
+    virtual void *registerVector(const char *modulename, const char *vectorname);
+    virtual void deregisterVector(void *vechandle);
+    virtual void setVectorAttribute(void *vechandle, const char *name, const char *value);
+    virtual bool record(void *vechandle, simtime_t t, double value);
+    virtual void flush();
+    virtual const char *getFileName() const { return fileName.c_str(); }
+};
+
+#endif
@@ -1,23 +1,122 @@
 #include "EtherMACFullDuplex.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include "EtherFrame.h"
+#include "VLConfig_m.h"
 #include "IPassiveQueue.h"
 #include "NotificationBoard.h"
 #include "NotifierConsts.h"
 #include "InterfaceEntry.h"
+#include "HotPathLog.h"
+#include "ObjectPool.h"
+#include "Ieee8021dRelay.h"
+
+// frame preemption (IEEE 802.3br)
+#define MIN_FRAGMENT_BYTES  64
+#define MCRC_BYTES          4
+#define SMD_FRAG_BYTES      1      // fragment count of a continuation fragment
+#define FRAGMENT_BOUNDARY_BYTES  8  // length unit of the fragments but the last one
+
+// tolerance of the credit-based shaper against rounding of the wake-up time, in bits
+#define CREDIT_EPSILON      1e-3
+
+// part of the frame needed to forward it in cut-through mode (preamble, SFD, MAC header)
+#define CUT_THROUGH_HEADER_BYTES    (PREAMBLE_BYTES + SFD_BYTES + 14)
 
 // TODO: refactor using a statemachine that is present in a single function
 // TODO: this helps understanding what interactions are there and how they affect the state
 
 Define_Module(EtherMACFullDuplex);
 
+simsignal_t EtherMACFullDuplex::dropPkQueueOverflowSignal = SIMSIGNAL_NULL;
+
 EtherMACFullDuplex::EtherMACFullDuplex()
 {
+    controlModule = NULL;
+    scheduleStore = NULL;
+    hotPathLogging = true;
+    recordLatency = switchPort = false;
+    residenceTime = NULL;
+    cutThrough = false;
+    numCutThroughFrames = numCutThroughBitErrors = 0;
+    classQueuing = false;
+    curTxClass = -1;
+    classQueueLimit = 0;
+    defaultTrafficClass = 0;
+    reselectMsg = NULL;
+    numDroppedQueueOverflow = 0;
+    tasEnabled = false;
+    numGateWaits = numGuardBandDrops = 0;
+    cbsEnabled = false;
+    numCreditWaits = 0;
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+    {
+        numOverflowDrops[tc] = 0;
+        idleSlope[tc] = credit[tc] = 0;
+    }
+    framePreemption = false;
+    expressClasses = 0;
+    preemptionSliceBytes = MIN_FRAGMENT_BYTES;
+    txSliced = txSendingMCRC = txResuming = false;
+    preemptedFrame = NULL;
+    preemptedClass = -1;
+    txOnDemand = false;
+    txMPacket = NULL;
+    txFrameBytes = txBytesSent = txMPacketBytes = 0;
+    txFragmentNumber = 0;
+    rxFragmentFrameId = -1;
+    rxFragmentBitError = false;
+    numPreemptions = numFragmentsSent = numReassembledFrames = 0;
+    txMetadataValid = false;
+    foldIFG = txIFGFolded = false;
+    burstMode = burstEndFolded = burstDelayed = false;
+    maxBurstFrames = 0;
+    burstNext = 0;
+    burstDepartureMsg = NULL;
+    burstTxrate = 0;
+    numBursts = numBurstFrames = numBurstInterruptions = 0;
+}
+
+EtherMACFullDuplex::~EtherMACFullDuplex()
+{
+    cancelAndDelete(reselectMsg);
+    cancelAndDelete(burstDepartureMsg);
+    for (unsigned int i = 0; i < burst.size(); i++)
+    {
+        if (!burstDelayed)
+            delete burst[i].frame;  // the delayed ones are in the future event set
+        delete burst[i].statFrame;
+    }
+    delete preemptedFrame;
+    delete residenceTime;
+    for (unsigned int i = 0; i < vlLatency.size(); i++)
+        delete vlLatency[i];
+}
+
+static const char *profiledHandlerNames[] = {
+    "handleSelfMessage", "processFrameFromUpperLayer", "processMsgFromNetwork", "processCutThroughHeader"
+};
+
+static unsigned char parseClassMask(const char *bits)
+{
+    if (strlen(bits) != NUM_TRAFFIC_CLASSES || strspn(bits, "01") != NUM_TRAFFIC_CLASSES)
+        throw cRuntimeError("Invalid traffic class mask '%s' (expected %d bits, T%d..T0)", bits, NUM_TRAFFIC_CLASSES, NUM_TRAFFIC_CLASSES - 1);
+    unsigned char mask = 0;
+    for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++)
+        if (bits[i] == '1')
+            mask |= 1 << (NUM_TRAFFIC_CLASSES - 1 - i);
+    return mask;
+}
+
+static inline int64 toNanoseconds(simtime_t t)
+{
+    return (int64)(t.dbl() * 1e9 + 0.5);
 }
 
 void EtherMACFullDuplex::initialize(int stage)
@@ -29,16 +128,92 @@ void EtherMACFullDuplex::initialize(int stage)
         if (!par("duplexMode").boolValue())
             throw cRuntimeError("Half duplex operation is not supported by EtherMACFullDuplex, use the EtherMAC module for that! (Please enable csmacdSupport on EthernetInterface)");
 
+        hotPathLogging = par("hotPathLogging").boolValue();
+
+        // la tabla de VLs se construye una única vez para el switch que contiene a la interfaz
+        cModule *switchModule = getParentModule()->getParentModule();
+        vlTable.load(par("vlConfig").xmlValue(), switchModule);
+        controlModule = switchModule->getSubmodule("appControl");
+        scheduleStore = ScheduleStore::findFor(switchModule);
+        if (!vlTable.isEmpty() && !scheduleStore)
+            throw cRuntimeError("Switch '%s' has VLs configured but no scheduleStore module", switchModule->getFullPath().c_str());
+
+        gateControlList.load(par("gateControlList").xmlValue());
+        tasEnabled = !gateControlList.isEmpty();
+        framePreemption = par("framePreemption").boolValue();
+        if (framePreemption)
+        {
+            expressClasses = parseClassMask(par("expressClasses").stringValue());
+            preemptionSliceBytes = par("preemptionSliceBytes");
+            if (preemptionSliceBytes < MIN_FRAGMENT_BYTES)
+                throw cRuntimeError("preemptionSliceBytes must be at least %d", MIN_FRAGMENT_BYTES);
+            WATCH(numPreemptions);
+        }
+
+        loadTrafficClasses(par("trafficClasses").xmlValue());
+        classQueuing = par("priorityQueuing").boolValue() || tasEnabled || cbsEnabled || framePreemption;
+        if (classQueuing)
+        {
+            if (txQueue.extQueue)
+                throw cRuntimeError("Per-class queuing, the shapers and frame preemption need the internal transmission queue (queueModule must be empty)");
+            classQueueLimit = par("txQueueLimit");
+            for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+            {
+                char name[16];
+                sprintf(name, "txQueue-tc%d", tc);
+                classQueue[tc].setName(name);
+            }
+            reselectMsg = new cMessage("reselect");
+            WATCH(numDroppedQueueOverflow);
+            if (tasEnabled)
+            {
+                WATCH(numGateWaits);
+                WATCH(numGuardBandDrops);
+            }
+            if (cbsEnabled)
+                WATCH(numCreditWaits);
+        }
+
+        if (par("profileHandlers").boolValue())
+            profiler.enable(profiledHandlerNames, NUM_PROFILED_HANDLERS);
+
+        recordLatency = par("recordLatency").boolValue();
+        switchPort = isSwitchPort();
+        if (recordLatency && switchPort)
+            residenceTime = new LogLinearHistogram();
+
+        foldIFG = par("foldIFG").boolValue();
+        burstMode = par("burstMode").boolValue();
+        if (burstMode)
+        {
+            maxBurstFrames = par("maxBurstFrames");
+            if (maxBurstFrames < 2)
+                throw cRuntimeError("maxBurstFrames must be at least 2");
+            burstDepartureMsg = new cMessage("burstDeparture");
+            WATCH(numBursts);
+            WATCH(numBurstInterruptions);
+        }
+
         beginSendFrames();
     }
 }
 
+bool EtherMACFullDuplex::isSwitchPort()
+{
+    cModule *node = getParentModule()->getParentModule();
+    for (cModule::SubmoduleIterator it(node); !it.end(); it++)
+        if (dynamic_cast<Ieee8021dRelay *>(it()))
+            return true;
+    return false;
+}
+
 void EtherMACFullDuplex::initializeStatistics()
 {
     EtherMACBase::initializeStatistics();
 
     // initialize statistics
     totalSuccessfulRxTime = 0.0;
+    dropPkQueueOverflowSignal = registerSignal("dropPkQueueOverflow");
 }
 
 void EtherMACFullDuplex::initializeFlags()
@@ -46,26 +221,50 @@ void EtherMACFullDuplex::initializeFlags()
     EtherMACBase::initializeFlags();
 
     duplexMode = true;
-    physInGate->setDeliverOnReceptionStart(false);
+    cutThrough = par("cutThrough").boolValue();
+    physInGate->setDeliverOnReceptionStart(cutThrough);
 }
 
 void EtherMACFullDuplex::handleMessage(cMessage *msg)
 {
     if (!isOperational)
     {
-        handleMessageWhenDown(msg);
+        if (msg->isSelfMessage() && dynamic_cast<EtherTraffic *>(msg))
+            delete msg;     // cut-through frame or fragment still being received when the interface went down
+        else
+            handleMessageWhenDown(msg);
         return;
     }
 
     if (channelsDiffer)
         readChannelParameters(true);
+    if (!burst.empty())
+        checkBurstLink();
 
     if (msg->isSelfMessage())
+    {
+        PROFILE_HANDLER(profiler, PROFILE_SELF_MESSAGE, msg->getKind());
         handleSelfMessage(msg);
+    }
     else if (msg->getArrivalGate() == upperLayerInGate)
+    {
+        PROFILE_HANDLER(profiler, PROFILE_UPPER_LAYER, msg->getKind());
         processFrameFromUpperLayer(check_and_cast<EtherFrame *>(msg));
+    }
     else if (msg->getArrivalGate() == physInGate)
-        processMsgFromNetwork(check_and_cast<EtherTraffic *>(msg));
+    {
+        EtherTraffic *traffic = check_and_cast<EtherTraffic *>(msg);
+        if (cutThrough && traffic->isReceptionStart())
+        {
+            PROFILE_HANDLER(profiler, PROFILE_CUT_THROUGH, msg->getKind());
+            processCutThroughHeader(traffic);
+        }
+        else
+        {
+            PROFILE_HANDLER(profiler, PROFILE_NETWORK, msg->getKind());
+            processMsgFromNetwork(traffic);
+        }
+    }
     else
         throw cRuntimeError("Message received from unknown gate!");
 
@@ -75,7 +274,7 @@ void EtherMACFullDuplex::handleMessage(cMessage *msg)
 
 void EtherMACFullDuplex::handleSelfMessage(cMessage *msg)
 {
-    EV << "Self-message " << msg << " received\n";
+    EV_HOT << "Self-message " << msg << " received\n";
 
     if (msg == endTxMsg)
         handleEndTxPeriod();
@@ -83,6 +282,12 @@ void EtherMACFullDuplex::handleSelfMessage(cMessage *msg)
         handleEndIFGPeriod();
     else if (msg == endPauseMsg)
         handleEndPausePeriod();
+    else if (msg == reselectMsg)
+        handleReselect();
+    else if (msg == burstDepartureMsg)
+        handleBurstDeparture();
+    else if (dynamic_cast<EtherTraffic *>(msg))
+        processMsgFromNetwork((EtherTraffic *)msg);     // cut-through: header or fragment received
     else
         throw cRuntimeError("Unknown self message received!");
 }
@@ -90,27 +295,476 @@ void EtherMACFullDuplex::handleSelfMessage(cMessage *msg)
 void EtherMACFullDuplex::startFrameTransmission()
 {
     ASSERT(curTxFrame);
-    EV << "Transmitting a copy of frame " << curTxFrame << endl;
 
-    EtherFrame *frame = curTxFrame->dup();  // note: we need to duplicate the frame because we emit a signal with it in endTxPeriod()
+    if (txResuming)
+    {
+        // continuation fragment of the preempted frame
+        txResuming = false;
+        txFragmentNumber++;
+        txMPacketBytes = 0;
+        sendNextSlice();
+        return;
+    }
 
-    if (frame->getSrc().isUnspecified())
-        frame->setSrc(address);
+    captureTxMetadata(curTxFrame);
+    txIFGFolded = false;
 
-    if (frame->getByteLength() < curEtherDescr->frameMinBytes)
-        frame->setByteLength(curEtherDescr->frameMinBytes);
+    if (residenceTime && txMetadata.vlId >= 0)
+        residenceTime->collect(toNanoseconds(simTime() - curTxFrame->getTimestamp()));
+
+    if (framePreemption && curTxClass >= 0 && !isExpressClass(curTxClass))
+    {
+        txFrameBytes = curTxFrame->getByteLength();
+        if (txFrameBytes < curEtherDescr->frameMinBytes)
+            txFrameBytes = curEtherDescr->frameMinBytes;
+
+        // shorter frames cannot be split into two fragments of the minimum size
+        if (txFrameBytes >= 2 * MIN_FRAGMENT_BYTES)
+        {
+            txSliced = true;
+            txBytesSent = txMPacketBytes = 0;
+            txFragmentNumber = 0;
+            sendNextSlice();
+            return;
+        }
+    }
+
+    // the frame itself goes out; handleEndTxPeriod() only needs txMetadata
+    EtherFrame *frame = curTxFrame;
+    curTxFrame = NULL;
+    emitTxSignals(frame, simTime() + getTransmissionDuration(frame));
+    prepareFrameForSending(frame);
 
     // add preamble and SFD (Starting Frame Delimiter), then send out
     frame->addByteLength(PREAMBLE_BYTES+SFD_BYTES);
 
     // send
-    EV << "Starting transmission of " << frame << endl;
+    EV_HOT << "Starting transmission of " << frame << endl;
     send(frame, physOutGate);
-
-    scheduleAt(transmissionChannel->getTransmissionFinishTime(), endTxMsg);
+    txMetadata.frame = frame;
+    txMetadata.frameArrival = frame->getArrivalTime();
+
+    // folded: one event at the end of the IFG instead of endTx and endIFG; a
+    // pending PAUSE request or the credit-based shaper need the end of the frame
+    txFinishTime = transmissionChannel->getTransmissionFinishTime();
+    txIFGFolded = foldIFG && !cbsEnabled && pauseUnitsRequested == 0;
+    simtime_t ifg = INTERFRAME_GAP_BITS / curEtherDescr->txrate;
+
+    if (burstMode && !tasEnabled && !cbsEnabled && !framePreemption && !txQueue.extQueue && pauseUnitsRequested == 0)
+        startBurst();
+    if (!burst.empty())
+        scheduleAt(burst.back().finishTime + ifg, endTxMsg);
+    else
+        scheduleAt(txIFGFolded ? txFinishTime + ifg : txFinishTime, endTxMsg);
     transmitState = TRANSMITTING_STATE;
 }
 
+EtherFrame *EtherMACFullDuplex::takeBurstFrame(int& trafficClass)
+{
+    // same order as selectFrameForTransmission() without gates and credits
+    trafficClass = -1;
+    if (!txQueue.innerQueue->empty())
+        return (EtherFrame *)txQueue.innerQueue->pop();
+    if (classQueuing)
+    {
+        for (int tc = NUM_TRAFFIC_CLASSES - 1; tc >= 0; tc--)
+        {
+            if (!classQueue[tc].empty())
+            {
+                trafficClass = tc;
+                return (EtherFrame *)classQueue[tc].pop();
+            }
+        }
+    }
+    return NULL;
+}
+
+void EtherMACFullDuplex::startBurst()
+{
+    // the frame just sent is the first one of the burst
+    BurstFrame first;
+    first.frame = first.statFrame = NULL;
+    first.metadata = txMetadata;
+    first.trafficClass = curTxClass;
+    first.departureTime = simTime();
+    first.finishTime = txFinishTime;
+
+    // the following frames go back to back with the IFG in between. They are
+    // sent right away with sendDelayed(), unless the receiver is in another
+    // partition of a parallel simulation: such a send cannot be taken back,
+    // so the frames then stay in the MAC and a timer sends each one
+    burstDelayed = !physOutGate->getPathEndGate()->getOwnerModule()->isPlaceholder();
+    simtime_t ifg = INTERFRAME_GAP_BITS / curEtherDescr->txrate;
+    int trafficClass;
+    EtherFrame *frame;
+    while ((burst.empty() || (int)burst.size() < maxBurstFrames) && (frame = takeBurstFrame(trafficClass)) != NULL)
+    {
+        if (burst.empty())
+            burst.push_back(first);
+
+        BurstFrame next;
+        next.frame = frame;
+        next.statFrame = NULL;
+        captureTxMetadata(frame);
+        next.metadata = txMetadata;
+        next.trafficClass = trafficClass;
+        next.departureTime = burst.back().finishTime + ifg;
+        next.finishTime = next.departureTime + getTransmissionDuration(frame);
+
+        if (burstDelayed)
+        {
+            if (residenceTime && next.metadata.vlId >= 0)
+                residenceTime->collect(toNanoseconds(next.departureTime - frame->getTimestamp()));
+
+            // the frame may be taken back before its departure: its signals are
+            // emitted at the end of the burst, with a copy of it as queued
+            next.statFrame = frame->dup();
+            prepareFrameForSending(frame);
+            frame->addByteLength(PREAMBLE_BYTES+SFD_BYTES);
+            EV_HOT << "Sending " << frame << " in a burst, departure at " << next.departureTime << endl;
+            sendDelayed(frame, next.departureTime - simTime(), physOutGate);
+            next.finishTime = transmissionChannel->getTransmissionFinishTime();
+            next.metadata.frame = frame;
+            next.metadata.frameArrival = frame->getArrivalTime();
+        }
+        burst.push_back(next);
+    }
+    txMetadata = first.metadata;
+
+    if (!burst.empty())
+    {
+        burstNext = 1;
+        if (!burstDelayed)
+            scheduleAt(burst[1].departureTime, burstDepartureMsg);
+        burstEndFolded = true;
+        burstTxrate = curEtherDescr->txrate;
+        numBursts++;
+        numBurstFrames += burst.size();
+    }
+}
+
+void EtherMACFullDuplex::handleBurstDeparture()
+{
+    // only without burstDelayed
+    BurstFrame& entry = burst[burstNext++];
+    EtherFrame *frame = entry.frame;
+    entry.frame = NULL;
+
+    if (residenceTime && entry.metadata.vlId >= 0)
+        residenceTime->collect(toNanoseconds(simTime() - frame->getTimestamp()));
+
+    emitTxSignals(frame, simTime() + getTransmissionDuration(frame));
+    prepareFrameForSending(frame);
+    frame->addByteLength(PREAMBLE_BYTES+SFD_BYTES);
+    EV_HOT << "Starting transmission of " << frame << " (frame " << burstNext << " of a burst of " << burst.size() << ")" << endl;
+    send(frame, physOutGate);
+    entry.metadata.frame = frame;
+    entry.metadata.frameArrival = frame->getArrivalTime();
+
+    simtime_t finishTime = transmissionChannel->getTransmissionFinishTime();
+    if (finishTime != entry.finishTime)
+    {
+        // the datarate has changed since the burst was planned: it ends with this frame
+        entry.finishTime = finishTime;
+        truncateBurst(burstNext, !burstEndFolded);
+        return;
+    }
+    if (burstNext < burst.size())
+        scheduleAt(burst[burstNext].departureTime, burstDepartureMsg);
+}
+
+bool EtherMACFullDuplex::hasDeparted(const BurstFrame& entry)
+{
+    // a delayed send has started at its departure time even if the
+    // corresponding event has not been processed yet
+    if (burstDelayed)
+        return entry.departureTime <= simTime();
+    return entry.frame == NULL;
+}
+
+void EtherMACFullDuplex::interruptBurst(bool endAtFrame, bool keepNextInIFG)
+{
+    // only the frames whose departure is still in the future are taken back.
+    // After a received PAUSE frame, the next frame still departs if the
+    // transmitter is in an IFG, as it would have without the burst
+    simtime_t now = simTime();
+    unsigned int length = 1;
+    while (length < burst.size() && hasDeparted(burst[length]))
+        length++;
+    bool inIFG = burst[length - 1].finishTime <= now;
+    if (inIFG && keepNextInIFG && length < burst.size())
+    {
+        length++;
+        inIFG = false;
+    }
+    if (inIFG)
+        endAtFrame = false;     // the frame has ended: the IFG after it is kept
+    if (length == burst.size() && (!endAtFrame || !burstEndFolded))
+        return;     // nothing to take back and the end stays as planned
+
+    EV << "Interrupting the burst after " << length << " of " << burst.size() << " frames\n";
+    truncateBurst(length, endAtFrame);
+}
+
+void EtherMACFullDuplex::truncateBurst(unsigned int length, bool endAtFrame)
+{
+    // the frames after the first length ones have not departed: they go back
+    // to the head of their queues
+    if (length < burst.size())
+    {
+        numBurstInterruptions++;
+        if (burstDelayed)
+        {
+            for (unsigned int i = length; i < burst.size(); i++)
+                revokeBurstFrame(burst[i]);
+            transmissionChannel->forceTransmissionFinishTime(burst[length - 1].finishTime);
+        }
+        requeueBurstFrames(length);
+        burst.resize(length);
+    }
+    if (!burstDelayed && burstNext >= burst.size())
+        cancelEvent(burstDepartureMsg);
+
+    cancelEvent(endTxMsg);
+    burstEndFolded = !endAtFrame;
+    simtime_t endTime = burst.back().finishTime;
+    scheduleAt(endAtFrame ? endTime : endTime + INTERFRAME_GAP_BITS / curEtherDescr->txrate, endTxMsg);
+}
+
+void EtherMACFullDuplex::revokeBurstFrame(BurstFrame& entry)
+{
+    // sent with sendDelayed() but not departed: still in the future event set
+    EtherFrame *frame = entry.frame;
+    simulation.msgQueue.remove(frame);
+    if (frame->getOwner() != this)
+        take(frame);
+    frame->addByteLength(-(PREAMBLE_BYTES+SFD_BYTES));
+    frame->setBitError(false);
+    frame->setArrivalTime(entry.metadata.arrivalTime);     // for the per-class delay
+    delete entry.statFrame;
+    entry.statFrame = NULL;
+}
+
+void EtherMACFullDuplex::requeueBurstFrames(unsigned int from)
+{
+    // the frames taken back were ahead of everything still queued, so each
+    // one goes before the head of its queue as it was; in the internal queue
+    // the PAUSE frames queued meanwhile stay ahead of the data frames
+    cQueue *innerQueue = txQueue.innerQueue;
+    cObject *pauseHead = innerQueue->empty() ? NULL : innerQueue->front();
+    cObject *dataHead = NULL;
+    for (cQueue::Iterator it(*innerQueue); !it.end(); it++)
+    {
+        if (!dynamic_cast<EtherPauseFrame *>(it()))
+        {
+            dataHead = it();
+            break;
+        }
+    }
+    cPacket *classHead[NUM_TRAFFIC_CLASSES];
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+        classHead[tc] = classQueue[tc].empty() ? NULL : classQueue[tc].front();
+
+    // a queue without head gets the frames appended after each other
+    for (unsigned int i = from; i < burst.size(); i++)
+    {
+        EtherFrame *frame = burst[i].frame;
+        int tc = burst[i].trafficClass;
+        if (tc >= 0)
+        {
+            if (classHead[tc])
+                classQueue[tc].insertBefore(classHead[tc], frame);
+            else
+                classQueue[tc].insert(frame);
+        }
+        else
+        {
+            cObject *head = dynamic_cast<EtherPauseFrame *>(frame) ? pauseHead : dataHead;
+            if (head)
+                innerQueue->insertBefore(head, frame);
+            else
+                innerQueue->insert(frame);  // by priority: after the PAUSE frames
+        }
+    }
+}
+
+void EtherMACFullDuplex::checkBurstLink()
+{
+    if (!connected)
+    {
+        // the frames already sent are recorded; the one on the wire and the
+        // ones that have not departed are lost with the link
+        simtime_t now = simTime();
+        for (unsigned int i = 0; i < burst.size(); i++)
+        {
+            BurstFrame& entry = burst[i];
+            if (i > 0 && !hasDeparted(entry))
+            {
+                if (burstDelayed)
+                    revokeBurstFrame(entry);
+                emit(dropPkIfaceDownSignal, entry.frame);
+                numDroppedIfaceDown++;
+                delete entry.frame;
+                continue;
+            }
+            txMetadata = entry.metadata;
+            curTxClass = entry.trafficClass;
+            if (entry.finishTime <= now)
+            {
+                if (entry.statFrame)
+                    emitTxSignals(entry.statFrame, entry.finishTime);
+                recordEndOfTransmission(entry.finishTime);
+            }
+            else if (entry.statFrame)
+            {
+                // its signals have not been emitted: the copy shows the frame
+                emit(dropPkIfaceDownSignal, entry.statFrame);
+                numDroppedIfaceDown++;
+            }
+            else
+                dropFrameOnWire();
+            delete entry.statFrame;
+        }
+        burst.clear();
+        txMetadataValid = false;
+        curTxClass = -1;
+        cancelEvent(burstDepartureMsg);
+        cancelEvent(endTxMsg);
+    }
+    else if (curEtherDescr->txrate != burstTxrate)
+    {
+        // the departure times were computed for the old datarate
+        burstTxrate = curEtherDescr->txrate;
+        interruptBurst(true, false);
+    }
+}
+
+void EtherMACFullDuplex::processConnectDisconnect()
+{
+    if (!connected)
+    {
+        // EtherMACBase only drops curTxFrame, which no longer holds the frame on the wire
+        if (!burst.empty())
+            checkBurstLink();
+        else if (transmitState == TRANSMITTING_STATE && txMetadataValid && !txSendingMCRC && !curTxFrame)
+        {
+            // (a frame sent in slices is still curTxFrame, dropped by EtherMACBase)
+            if (txIFGFolded && txFinishTime <= simTime())
+                recordEndOfTransmission(txFinishTime);  // only the folded IFG was left
+            else
+                dropFrameOnWire();
+        }
+        txMetadataValid = false;
+        txIFGFolded = false;
+        curTxClass = -1;
+
+        // a frame sent in slices is curTxFrame (dropped by EtherMACBase); a
+        // preempted one waits here to be resumed
+        if (preemptedFrame)
+        {
+            emit(dropPkIfaceDownSignal, preemptedFrame);
+            numDroppedIfaceDown++;
+            delete preemptedFrame;
+            preemptedFrame = NULL;
+        }
+        txSliced = txSendingMCRC = txResuming = false;
+        txMPacket = NULL;
+        preemptedClass = -1;
+        preemptedTxMetadata = TxMetadata();
+
+        // EtherMACBase only flushes the internal queue
+        if (classQueuing)
+        {
+            cancelEvent(reselectMsg);
+            for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+            {
+                while (!classQueue[tc].empty())
+                {
+                    EtherFrame *frame = (EtherFrame *)classQueue[tc].pop();
+                    emit(dropPkIfaceDownSignal, frame);
+                    numDroppedIfaceDown++;
+                    delete frame;
+                }
+            }
+        }
+
+        // with the queues empty the shaped classes start again from zero credit
+        if (cbsEnabled)
+        {
+            for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+                credit[tc] = 0;
+            creditUpdateTime = simTime();
+        }
+    }
+
+    EtherMACBase::processConnectDisconnect();
+}
+
+void EtherMACFullDuplex::dropFrameOnWire()
+{
+    // its packetSentToLower and txPk signals have already been emitted,
+    // unless it was in an mPacket that could still be cut; the frame itself
+    // can only be shown while it has not reached the receiver
+    EV << "Interface is not connected -- transmission of frame (vl " << txMetadata.vlId << ") aborted\n";
+    if (simTime() < txMetadata.frameArrival)
+        emit(dropPkIfaceDownSignal, txMetadata.frame);
+    numDroppedIfaceDown++;
+}
+
+void EtherMACFullDuplex::receiveSignal(cComponent *src, simsignal_t signalId, cObject *obj)
+{
+    EtherMACBase::receiveSignal(src, signalId, obj);
+
+    if (signalId == POST_MODEL_CHANGE && !burst.empty())
+        checkBurstLink();
+}
+
+void EtherMACFullDuplex::emitAtTxEnd(simsignal_t signal, cObject *obj, simtime_t endTime)
+{
+    if (endTime == simTime())
+        emit(signal, obj);
+    else
+    {
+        // the end of the frame is not now: the result recorders take the time from the value
+        cTimestampedValue value(endTime, obj);
+        emit(signal, &value);
+    }
+}
+
+void EtherMACFullDuplex::emitAtTxEnd(simsignal_t signal, long l, simtime_t endTime)
+{
+    if (endTime == simTime())
+        emit(signal, l);
+    else
+    {
+        cTimestampedValue value(endTime, l);
+        emit(signal, &value);
+    }
+}
+
+void EtherMACFullDuplex::captureTxMetadata(EtherFrame *frame)
+{
+    EtherPauseFrame *pauseFrame = dynamic_cast<EtherPauseFrame *>(frame);
+    txMetadata.isPauseFrame = pauseFrame != NULL;
+    txMetadata.pauseUnits = pauseFrame ? pauseFrame->getPauseTime() : 0;
+    txMetadata.byteLength = frame->getByteLength();
+    txMetadata.frameByteLength = frame->getFrameByteLength();
+    txMetadata.vlId = VLTable::parseVLId(frame->getName());
+    txMetadata.arrivalTime = frame->getArrivalTime();
+    txMetadata.frame = NULL;
+    txMetadata.frameArrival = SIMTIME_ZERO;
+    txMetadataValid = true;
+}
+
+void EtherMACFullDuplex::prepareFrameForSending(EtherFrame *frame)
+{
+    if (frame->getSrc().isUnspecified())
+        frame->setSrc(address);
+
+    if (frame->getByteLength() < curEtherDescr->frameMinBytes)
+        frame->setByteLength(curEtherDescr->frameMinBytes);
+}
+
 void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
 {
     if (frame->getByteLength() < MIN_ETHERNET_FRAME_BYTES)
@@ -118,7 +772,7 @@ void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
 
     frame->setFrameByteLength(frame->getByteLength());
 
-    EV << "Received frame from upper layer: " << frame << endl;
+    EV_HOT << "Received frame from upper layer: " << frame << endl;
 
     emit(packetReceivedFromUpperSignal, frame);
 
@@ -157,6 +811,30 @@ void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
         emit(rxPkFromHLSignal, frame);
     }
 
+    if (classQueuing && !isPauseFrame)
+    {
+        int tc = classifyFrame(frame);
+        cPacketQueue& queue = classQueue[tc];
+        if (classQueueLimit && queue.length() >= classQueueLimit)
+        {
+            dropOverflowFrame(frame, tc);
+            return;
+        }
+        if (cbsEnabled)
+            updateCredits();    // the credit of an empty queue is not kept from here on
+        EV_HOT << "Frame " << frame << " arrived from higher layers, enqueueing in " << queue.getName() << "\n";
+        queue.insert(frame);
+
+        // the frame is chosen among all classes when the transmitter becomes free
+        if (transmitState == TX_IDLE_STATE)
+            beginSendFrames();
+        else if (!burst.empty() && tc > burst.back().trafficClass)
+            interruptBurst(false, false);  // it goes before the rest of the burst
+        else if (isExpressClass(tc))
+            checkPreemption();
+        return;
+    }
+
     if (txQueue.extQueue)
     {
         ASSERT(curTxFrame == NULL);
@@ -165,15 +843,21 @@ void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
     else
     {
         if (txQueue.innerQueue->isFull())
-            error("txQueue length exceeds %d -- this is probably due to "
-                  "a bogus app model generating excessive traffic "
-                  "(or if this is normal, increase txQueueLimit!)",
-                  txQueue.innerQueue->getQueueLimit());
+        {
+            dropOverflowFrame(frame, -1);
+            return;
+        }
         // store frame and possibly begin transmitting
-        EV << "Frame " << frame << " arrived from higher layers, enqueueing\n";
+        EV_HOT << "Frame " << frame << " arrived from higher layers, enqueueing\n";
         txQueue.innerQueue->insertFrame(frame);
-
-        if (!curTxFrame && !txQueue.innerQueue->empty())
+        if (isPauseFrame && !burst.empty())
+            interruptBurst(false, false);  // PAUSE frames go before the rest of the burst
+        if (isPauseFrame)
+            checkPreemption();
+
+        // (while a frame is on the wire curTxFrame is NULL, but the next
+        // frame is only taken at the end of the transmission)
+        if (!curTxFrame && transmitState != TRANSMITTING_STATE && !txQueue.innerQueue->empty())
             curTxFrame = (EtherFrame*)txQueue.innerQueue->pop();
     }
 
@@ -183,250 +867,15 @@ void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
 
 void EtherMACFullDuplex::processMsgFromNetwork(EtherTraffic *msg)
 {
-    EV << "Received frame from network: " << msg << endl;
+    EV_HOT << "Received frame from network: " << msg << endl;
 
     // En este módulo la modificación consiste en la identificación del flujo generado de tráfico
     // Se obtiene la identificación del flujo y el tiempo de llegada el cual es enviado al nodo
-    // appControl
-
-    const char *mensaje = msg->getName();
-    int tempo = 0;
-    char config[15];
-
-    cModule *parentModule = getParentModule();
-    cModule *pparentModule = parentModule->getParentModule();
-    const char *modulo = pparentModule->getName();
-    cModule *targetModule = pparentModule->getSubmodule("appControl");
-    cModule *red = pparentModule->getParentModule();
-    char nombremoduloin[12];
-    sprintf(nombremoduloin, "%s_ctc",mensaje);
-
-    if (strncmp(modulo,"switch_1",8) == 0){
-        if ((strcmp(mensaje,"vl_227")==0) || (strcmp(mensaje,"vl_218")==0) || (strcmp(mensaje,"vl_217")==0) ){
-
-            cModule *nodo = red->getSubmodule("señalizador");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-            sprintf(config, "%s %d",mensaje,tempo);
-            sendDirect(new cMessage(config), targetModule, "direct");
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+5);
-            moduloin->par("permanence_pit").setLongValue(tempo+5);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+6);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+7);
-
-        }
-        else if((strcmp(mensaje,"vl_219")==0) || (strcmp(mensaje,"vl_229")==0)){
-
-            cModule *nodo = red->getSubmodule("alzavidrio_dd");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-        }
-        else if((strcmp(mensaje,"vl_239")==0) || (strcmp(mensaje,"vl_249")==0)){
-            cModule *nodo = red->getSubmodule("alzavidrio_di");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-        }
-    }
-
-    else if(strncmp(modulo,"switch_2",8) == 0 ){
-
-        if(mensaje[5]=='0'){
-
-            cModule *nodo = red->getSubmodule("contacto");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-            sprintf(config, "%s %d",mensaje,tempo);
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-            sendDirect(new cMessage(config), targetModule, "direct");
-
-        }else if (mensaje[5]=='4'){
-
-            cModule *nodo = red->getSubmodule("freno");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-            sprintf(config, "%s %d",mensaje,tempo);
-            sendDirect(new cMessage(config), targetModule, "direct");
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            int window_start = moduloin->par("receive_window_start");
-            int window_end = moduloin->par("receive_window_end");
-            int permanence_pit = moduloin->par("permanence_pit");
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            int sendWindowStart = moduloout->par("sendWindowStart");
-            int sendWindowEnd = moduloout->par("sendWindowEnd");
-
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-
-        }else if((strcmp(mensaje,"vl_211")==0)){
-
-            cModule *nodo = red->getSubmodule("modulo_clima");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-
-        }else if(mensaje[5]=='3'){
+    // appControl. El flujo se clasifica con la tabla de VLs construida en initialize()
 
-            cModule *nodo = red->getSubmodule("velocimetro");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-        }else if(mensaje[5]=='2'){
-            cModule *nodo = red->getSubmodule("acelerador");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-        }else if(mensaje[5]=='5'){
-
-            cModule *nodo = red->getSubmodule("manubrio");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+5);
-            moduloin->par("permanence_pit").setLongValue(tempo+5);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+6);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+7);
-
-        }else if(mensaje[5]=='6'){
-            cModule *nodo = red->getSubmodule("transmision");
-            cModule *owner = nodo->getSubmodule(mensaje);
-            int tick = owner->par("sendWindowStart");
-            tempo = tick + 5;
-
-            cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-            moduloin->par("receive_window_start").setLongValue(tempo);
-            moduloin->par("receive_window_end").setLongValue(tempo+10);
-            moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-            cModule *moduloout = pparentModule->getSubmodule(mensaje);
-            moduloout->par("sendWindowStart").setLongValue(tempo+11);
-            moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-        }
-
-    }
-    if (strncmp(modulo,"switch_3",8) == 0){
-            if((strcmp(mensaje,"vl_219")==0) || (strcmp(mensaje,"vl_229")==0)){
-                cModule *nodo = red->getSubmodule("alzavidrio_td");
-                cModule *owner = nodo->getSubmodule(mensaje);
-                int tick = owner->par("sendWindowStart");
-                tempo = tick + 5;
-
-                cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-                moduloin->par("receive_window_start").setLongValue(tempo);
-                moduloin->par("receive_window_end").setLongValue(tempo+10);
-                moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-                cModule *moduloout = pparentModule->getSubmodule(mensaje);
-                moduloout->par("sendWindowStart").setLongValue(tempo+11);
-                moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-            }
-            else if((strcmp(mensaje,"vl_239")==0) || (strcmp(mensaje,"vl_249")==0)){
-                cModule *nodo = red->getSubmodule("alzavidrio_ti");
-                cModule *owner = nodo->getSubmodule(mensaje);
-                int tick = owner->par("sendWindowStart");
-                tempo = tick + 5;
-
-                cModule *moduloin = pparentModule->getSubmodule(nombremoduloin);
-
-                moduloin->par("receive_window_start").setLongValue(tempo);
-                moduloin->par("receive_window_end").setLongValue(tempo+10);
-                moduloin->par("permanence_pit").setLongValue(tempo+10);
-
-                cModule *moduloout = pparentModule->getSubmodule(mensaje);
-                moduloout->par("sendWindowStart").setLongValue(tempo+11);
-                moduloout->par("sendWindowEnd").setLongValue(tempo+12);
-
-            }
-        }
+    const VLEntry *vl = vlTable.lookup(VLTable::parseVLId(msg->getName()));
+    if (vl && !scheduleStore->isStatic())
+        reconfigureVLWindows(vl);
 
     if (!connected || disabled)
     {
@@ -441,6 +890,13 @@ void EtherMACFullDuplex::processMsgFromNetwork(EtherTraffic *msg)
         return;
     }
 
+    EtherFragment *fragment = dynamic_cast<EtherFragment *>(msg);
+    if (fragment)
+    {
+        processReceivedFragment(fragment);
+        return;
+    }
+
     EtherFrame *frame = dynamic_cast<EtherFrame *>(msg);
     if (!frame)
     {
@@ -452,7 +908,13 @@ void EtherMACFullDuplex::processMsgFromNetwork(EtherTraffic *msg)
     totalSuccessfulRxTime += frame->getDuration();
 
     // bit errors
-    if (frame->hasBitError())
+    if (frame->hasBitError() && cutThrough && frame->isReceptionStart())
+    {
+        // already being forwarded before the FCS is known: the next hop drops it
+        numCutThroughBitErrors++;
+        EV_HOT << "Cut-through frame " << frame << " has a bad FCS, forwarding it anyway\n";
+    }
+    else if (frame->hasBitError())
     {
         numDroppedBitError++;
         emit(dropPkBitErrorSignal, frame);
@@ -477,13 +939,50 @@ void EtherMACFullDuplex::processMsgFromNetwork(EtherTraffic *msg)
     }
 }
 
+void EtherMACFullDuplex::processCutThroughHeader(EtherTraffic *msg)
+{
+    // fragments of preempted frames are not forwarded before they are
+    // complete: they are processed at the end of their reception
+    if (!dynamic_cast<EtherFrame *>(msg))
+    {
+        scheduleAt(simTime() + msg->getDuration(), msg);
+        return;
+    }
+
+    // the frame is processed once the header has been received; the rest of it
+    // is still on the wire (msg->getDuration())
+    simtime_t headerTime = CUT_THROUGH_HEADER_BYTES * 8 / curEtherDescr->txrate;
+    if (headerTime > msg->getDuration())
+        headerTime = msg->getDuration();
+    numCutThroughFrames++;
+    scheduleAt(simTime() + headerTime, msg);
+}
+
+void EtherMACFullDuplex::reconfigureVLWindows(const VLEntry *vl)
+{
+    int tick = vl->sendWindowStart();
+    int tempo = tick + vl->receiveOffset;
+
+    if (vl->notifyControl)
+    {
+        VLConfigPacket *config = new Pooled<VLConfigPacket>("configuracion");
+        config->setVlId(vl->vlId);
+        config->setWindowTime(tempo);
+        sendDirect(config, controlModule, "direct");
+    }
+
+    // ventanas de entrada y de salida
+    scheduleStore->setWindows(vl->vlId, tempo, tempo + vl->receiveLength, tempo + vl->receiveLength,
+                              tempo + vl->sendStartOffset, tempo + vl->sendEndOffset);
+}
+
 void EtherMACFullDuplex::handleEndIFGPeriod()
 {
     if (transmitState != WAIT_IFG_STATE)
         error("Not in WAIT_IFG_STATE at the end of IFG period");
 
     // End of IFG period, okay to transmit
-    EV << "IFG elapsed" << endl;
+    EV_HOT << "IFG elapsed" << endl;
 
     beginSendFrames();
 }
@@ -494,31 +993,50 @@ void EtherMACFullDuplex::handleEndTxPeriod()
     if (transmitState != TRANSMITTING_STATE)
         error("End of transmission, and incorrect state detected");
 
-    if (NULL == curTxFrame)
-        error("Frame under transmission cannot be found");
-
-    emit(packetSentToLowerSignal, curTxFrame);  //consider: emit with start time of frame
+    if (txSliced && !handleEndOfSlice())
+        return;
 
-    if (dynamic_cast<EtherPauseFrame*>(curTxFrame) != NULL)
+    bool ifgElapsed;
+    if (!burst.empty())
     {
-        numPauseFramesSent++;
-        emit(txPausePkUnitsSignal, ((EtherPauseFrame*)curTxFrame)->getPauseTime());
+        for (unsigned int i = 0; i < burst.size(); i++)
+        {
+            BurstFrame& entry = burst[i];
+            txMetadata = entry.metadata;
+            curTxClass = entry.trafficClass;
+            if (entry.statFrame)
+            {
+                emitTxSignals(entry.statFrame, entry.finishTime);
+                delete entry.statFrame;
+            }
+            recordEndOfTransmission(entry.finishTime);
+        }
+        ifgElapsed = burstEndFolded;
+        lastTxFinishTime = burst.back().finishTime;
+        burst.clear();
     }
     else
     {
-        unsigned long curBytes = curTxFrame->getFrameByteLength();
-        numFramesSent++;
-        numBytesSent += curBytes;
-        emit(txPkSignal, curTxFrame);
+        if (!txMetadataValid)
+            error("Frame under transmission cannot be found");
+        ifgElapsed = txIFGFolded;
+        lastTxFinishTime = txIFGFolded ? txFinishTime : simTime();
+        recordEndOfTransmission(lastTxFinishTime);
     }
 
-    EV << "Transmission of " << curTxFrame << " successfully completed\n";
-    delete curTxFrame;
-    curTxFrame = NULL;
-    lastTxFinishTime = simTime();
+    txMetadataValid = false;
+    txIFGFolded = false;
+    curTxClass = -1;
     getNextFrameFromQueue();
 
-    if (pauseUnitsRequested > 0)
+    if (ifgElapsed)
+    {
+        // the IFG is over as well; a PAUSE request received during the IFG
+        // applies to the end of the next frame, as without folding
+        EV_HOT << "IFG elapsed" << endl;
+        beginSendFrames();
+    }
+    else if (pauseUnitsRequested > 0)
     {
         // if we received a PAUSE frame recently, go into PAUSE state
         EV << "Going to PAUSE mode for " << pauseUnitsRequested << " time units\n";
@@ -528,9 +1046,470 @@ void EtherMACFullDuplex::handleEndTxPeriod()
     }
     else
     {
-        EV << "Start IFG period\n";
+        EV_HOT << "Start IFG period\n";
+        scheduleEndIFGPeriod();
+    }
+}
+
+void EtherMACFullDuplex::emitTxSignals(EtherFrame *frame, simtime_t endTime)
+{
+    // called before the frame is sent, as the receiver may delete it before
+    // its end: the frame is still as queued, without preamble and SFD
+    emitAtTxEnd(packetSentToLowerSignal, frame, endTime);  //consider: emit with start time of frame
+    if (dynamic_cast<EtherPauseFrame *>(frame) == NULL)
+        emitAtTxEnd(txPkSignal, frame, endTime);
+}
+
+void EtherMACFullDuplex::recordEndOfTransmission(simtime_t endTime)
+{
+    // packetSentToLower and txPk have been emitted by emitTxSignals()
+    if (txMetadata.isPauseFrame)
+    {
+        numPauseFramesSent++;
+        emitAtTxEnd(txPausePkUnitsSignal, txMetadata.pauseUnits, endTime);
+    }
+    else
+    {
+        unsigned long curBytes = txMetadata.frameByteLength;
+        numFramesSent++;
+        numBytesSent += curBytes;
+    }
+
+    if (classQueuing && curTxClass >= 0)
+    {
+        classDelay[curTxClass].collect(endTime - txMetadata.arrivalTime);
+        if (cbsEnabled)
+            updateCredits();    // the class stops transmitting
+    }
+
+    EV_HOT << "Transmission of " << (txMetadata.isPauseFrame ? "PAUSE frame" : "frame")
+           << " (vl " << txMetadata.vlId << ", " << txMetadata.byteLength << " bytes) successfully completed\n";
+}
+
+void EtherMACFullDuplex::handleReselect()
+{
+    // frames are only started here if the transmitter is idle; otherwise
+    // they are selected at the end of the current transmission, IFG or
+    // PAUSE, but an express frame may preempt the frame on the wire
+    EV_HOT << "Gate control list transition or credit recovered" << endl;
+    if (transmitState == TX_IDLE_STATE)
+        beginSendFrames();
+    else
+        checkPreemption();
+}
+
+void EtherMACFullDuplex::loadTrafficClasses(cXMLElement *classes)
+{
+    vlTrafficClass.clear();
+    defaultTrafficClass = 0;
+    if (!classes)
+        return;
+
+    const char *defaultClass = classes->getAttribute("default");
+    if (defaultClass)
+        defaultTrafficClass = atoi(defaultClass);
+    if (defaultTrafficClass < 0 || defaultTrafficClass >= NUM_TRAFFIC_CLASSES)
+        throw cRuntimeError("Invalid default traffic class %d at %s", defaultTrafficClass, classes->getSourceLocation());
+
+    cXMLElementList vls = classes->getChildrenByTagName("vl");
+    for (cXMLElementList::iterator it = vls.begin(); it != vls.end(); it++)
+    {
+        const char *id = (*it)->getAttribute("id");
+        const char *trafficClass = (*it)->getAttribute("class");
+        if (!id || !trafficClass)
+            throw cRuntimeError("VL traffic class needs id and class attributes at %s", (*it)->getSourceLocation());
+        int vlId = atoi(id);
+        int tc = atoi(trafficClass);
+        if (vlId < 0 || tc < 0 || tc >= NUM_TRAFFIC_CLASSES)
+            throw cRuntimeError("Invalid VL id or traffic class at %s", (*it)->getSourceLocation());
+        if (vlId >= (int)vlTrafficClass.size())
+            vlTrafficClass.resize(vlId + 1, -1);
+        vlTrafficClass[vlId] = tc;
+    }
+
+    cXMLElementList shapers = classes->getChildrenByTagName("shaper");
+    for (cXMLElementList::iterator it = shapers.begin(); it != shapers.end(); it++)
+    {
+        const char *trafficClass = (*it)->getAttribute("class");
+        const char *slope = (*it)->getAttribute("idleSlope");
+        if (!trafficClass || !slope)
+            throw cRuntimeError("Credit-based shaper needs class and idleSlope attributes at %s", (*it)->getSourceLocation());
+        int tc = atoi(trafficClass);
+        if (tc < 0 || tc >= NUM_TRAFFIC_CLASSES)
+            throw cRuntimeError("Invalid traffic class at %s", (*it)->getSourceLocation());
+        idleSlope[tc] = cNEDValue::parseQuantity(slope, "bps");
+        if (idleSlope[tc] <= 0)
+            throw cRuntimeError("idleSlope must be positive at %s", (*it)->getSourceLocation());
+        cbsEnabled = true;
+    }
+}
+
+int EtherMACFullDuplex::classifyFrame(EtherFrame *frame)
+{
+    int vlId = VLTable::parseVLId(frame->getName());
+    if (vlId >= 0 && vlId < (int)vlTrafficClass.size() && vlTrafficClass[vlId] >= 0)
+        return vlTrafficClass[vlId];
+    return defaultTrafficClass;
+}
+
+simtime_t EtherMACFullDuplex::getTransmissionDuration(EtherFrame *frame)
+{
+    int64 bytes = frame->getByteLength();
+    if (bytes < curEtherDescr->frameMinBytes)
+        bytes = curEtherDescr->frameMinBytes;
+    return (bytes + PREAMBLE_BYTES + SFD_BYTES) * 8 / curEtherDescr->txrate;
+}
+
+void EtherMACFullDuplex::dropOverflowFrame(EtherFrame *frame, int trafficClass)
+{
+    EV << "Transmission queue " << (trafficClass >= 0 ? classQueue[trafficClass].getName() : "txQueue")
+       << " full, dropping frame " << frame << endl;
+    emit(dropPkQueueOverflowSignal, frame);
+    numDroppedQueueOverflow++;
+    if (trafficClass >= 0)
+        numOverflowDrops[trafficClass]++;
+    delete frame;
+}
+
+void EtherMACFullDuplex::updateCredits()
+{
+    // credit since the last update; the state of the queues and of the
+    // transmitter has not changed in between (every change calls this first)
+    simtime_t now = simTime();
+    double dt = (now - creditUpdateTime).dbl();
+    creditUpdateTime = now;
+    if (dt == 0)
+        return;
+
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+    {
+        if (idleSlope[tc] == 0)
+            continue;
+        if (transmitState == TRANSMITTING_STATE && curTxClass == tc)
+            credit[tc] += (idleSlope[tc] - curEtherDescr->txrate) * dt;     // sendSlope
+        else if (!classQueue[tc].empty())
+            credit[tc] += idleSlope[tc] * dt;
+        else if (credit[tc] > 0)
+            credit[tc] = 0;     // positive credit is lost when the queue runs empty
+        else
+            credit[tc] = std::min(0.0, credit[tc] + idleSlope[tc] * dt);
+    }
+}
+
+bool EtherMACFullDuplex::selectFrameForTransmission()
+{
+    simtime_t now = simTime();
+    bool waitingForGate = false;
+    simtime_t creditRecovery = MAXTIME;
+
+    if (cbsEnabled)
+        updateCredits();
+
+    // MAC control frames (PAUSE) are not subject to the gates
+    if (!txQueue.innerQueue->empty())
+    {
+        curTxFrame = (EtherFrame *)txQueue.innerQueue->pop();
+        curTxClass = -1;
+        return true;
+    }
+
+    for (int tc = NUM_TRAFFIC_CLASSES - 1; tc >= 0; tc--)
+    {
+        if (preemptedFrame && !isExpressClass(tc))
+        {
+            // the preempted frame is completed before any other preemptable frame starts
+            if (gateControlList.isOpen(preemptedClass, now))
+            {
+                curTxFrame = preemptedFrame;
+                curTxClass = preemptedClass;
+                txMetadata = preemptedTxMetadata;
+                txMetadataValid = true;
+                preemptedFrame = NULL;
+                txSliced = txResuming = true;
+                return true;
+            }
+            waitingForGate = true;
+            break;
+        }
+
+        cPacketQueue& queue = classQueue[tc];
+        if (!queue.empty() && idleSlope[tc] > 0 && credit[tc] < -CREDIT_EPSILON)
+        {
+            // shaped class without credit: lower classes may still be sent
+            simtime_t recovery = now + -credit[tc] / idleSlope[tc];
+            if (recovery < creditRecovery)
+                creditRecovery = recovery;
+            continue;
+        }
+        while (!queue.empty())
+        {
+            EtherFrame *frame = (EtherFrame *)queue.front();
+            simtime_t duration = getTransmissionDuration(frame);
+
+            if (duration > gateControlList.getMaxOpenTime(tc))
+            {
+                // longer than any window of its gate: it would block the class forever
+                EV << "Frame " << frame << " does not fit in any window of traffic class " << tc << ", dropping\n";
+                numGuardBandDrops++;
+                delete queue.pop();
+                continue;
+            }
+
+            // guard band: the frame must be completely sent before its gate closes
+            if (gateControlList.getCloseTime(tc, now) >= now + duration)
+            {
+                curTxFrame = (EtherFrame *)queue.pop();
+                curTxClass = tc;
+                return true;
+            }
+            waitingForGate = true;
+            break;
+        }
+    }
+
+    // wake up at the next gate transition or when a shaped class gets its credit back
+    simtime_t wakeUp = creditRecovery;
+    if (waitingForGate)
+    {
+        numGateWaits++;
+        wakeUp = std::min(wakeUp, gateControlList.getNextChange(now));
+    }
+    if (creditRecovery < MAXTIME)
+        numCreditWaits++;
+    scheduleReselect(wakeUp);
+    return false;
+}
+
+void EtherMACFullDuplex::scheduleReselect(simtime_t wakeUp)
+{
+    if (wakeUp < MAXTIME && (!reselectMsg->isScheduled() || reselectMsg->getArrivalTime() > wakeUp))
+    {
+        cancelEvent(reselectMsg);
+        scheduleAt(wakeUp, reselectMsg);
+    }
+}
+
+bool EtherMACFullDuplex::isExpressFrameWaiting()
+{
+    if (!txQueue.innerQueue->empty())
+        return true;
+    simtime_t now = simTime();
+    for (int tc = NUM_TRAFFIC_CLASSES - 1; tc >= 0; tc--)
+        if (isExpressClass(tc) && !classQueue[tc].empty() && gateControlList.isOpen(tc, now))
+            return true;
+    return false;
+}
+
+bool EtherMACFullDuplex::canPreemptOnDemand()
+{
+    // the mPacket on the wire is cut in the future event set, which is not
+    // possible once the receiver has it (delivery at the start of the
+    // reception) or for a receiver in another partition
+    cGate *gate = physOutGate->getPathEndGate();
+    return !gate->getDeliverOnReceptionStart() && !gate->getOwnerModule()->isPlaceholder();
+}
+
+void EtherMACFullDuplex::sendNextSlice()
+{
+    // on demand an mPacket carries the whole rest of the frame and is only
+    // cut when an express frame becomes eligible (preemptMPacket()); the
+    // fallback sends it in slices and preempts at their ends
+    if (txMPacketBytes == 0)
+        txOnDemand = canPreemptOnDemand();
+    long remaining = txFrameBytes - txBytesSent;
+    long slice = remaining;
+    if (!txOnDemand)
+    {
+        slice = remaining < preemptionSliceBytes ? remaining : preemptionSliceBytes;
+        if (remaining - slice < MIN_FRAGMENT_BYTES)
+            slice = remaining;      // the rest could not be sent as a fragment of its own
+    }
+
+    EtherFragment *fragment = new Pooled<EtherFragment>("mPacket");
+    fragment->setFrameId(curTxFrame->getId());
+    fragment->setFragmentNumber(txFragmentNumber);
+
+    long overhead = 0;
+    if (txMPacketBytes == 0)
+        overhead = PREAMBLE_BYTES + SFD_BYTES + (txFragmentNumber > 0 ? SMD_FRAG_BYTES : 0);
+
+    txBytesSent += slice;
+    txMPacketBytes += slice;
+    if (txBytesSent == txFrameBytes)
+    {
+        // the last slice carries the frame itself to the receiving MAC; an
+        // mPacket sent on demand may still be cut, so its signals wait
+        EtherFrame *frame = curTxFrame;
+        curTxFrame = NULL;
+        if (!txOnDemand)
+            emitTxSignals(frame, simTime() + (slice + overhead) * 8 / curEtherDescr->txrate);
+        prepareFrameForSending(frame);
+        fragment->encapsulate(frame);
+        txMetadata.frame = frame;
+    }
+    fragment->setByteLength(slice + overhead);
+    numFragmentsSent++;
+
+    // endTxMsg is inserted before the mPacket, so that at the end of the
+    // transmission the receiver has not consumed it yet
+    scheduleAt(simTime() + fragment->getBitLength() / curEtherDescr->txrate, endTxMsg);
+    EV_HOT << "Sending slice " << txFragmentNumber << ": " << txBytesSent << "/" << txFrameBytes << " bytes\n";
+    send(fragment, physOutGate);
+    if (!curTxFrame)
+        txMetadata.frameArrival = fragment->getArrivalTime();
+    transmitState = TRANSMITTING_STATE;
+
+    txMPacket = txOnDemand ? fragment : NULL;
+    if (txMPacket)
+        checkPreemption();
+}
+
+void EtherMACFullDuplex::checkPreemption()
+{
+    // an mPacket sent on demand is cut as soon as an express frame (or a
+    // PAUSE frame) becomes eligible
+    if (!txMPacket || txSendingMCRC)
+        return;
+    if (isExpressFrameWaiting())
+    {
+        preemptMPacket();
+        return;
+    }
+
+    // express frames behind a closed gate: look again at the next transition
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+    {
+        if (isExpressClass(tc) && !classQueue[tc].empty())
+        {
+            scheduleReselect(gateControlList.getNextChange(simTime()));
+            return;
+        }
+    }
+}
+
+void EtherMACFullDuplex::preemptMPacket()
+{
+    // the mPacket ends at the next fragment boundary with at least 64 bytes
+    // of it sent, followed by the mCRC; at least 64 bytes must be left
+    EtherFragment *fragment = txMPacket;
+    simtime_t start = fragment->getSendingTime();
+    double txrate = curEtherDescr->txrate;
+    long overhead = PREAMBLE_BYTES + SFD_BYTES + (txFragmentNumber > 0 ? SMD_FRAG_BYTES : 0);
+    long sent = (long)ceil((simTime() - start).dbl() * txrate / 8) - overhead;
+    long cut = std::max(sent, (long)MIN_FRAGMENT_BYTES);
+    cut = (cut + FRAGMENT_BOUNDARY_BYTES - 1) / FRAGMENT_BOUNDARY_BYTES * FRAGMENT_BOUNDARY_BYTES;
+    if (txMPacketBytes - cut < MIN_FRAGMENT_BYTES)
+        return;     // too close to its end: the express frame waits for it
+
+    // the mPacket has not reached the receiver yet: it is shortened in the
+    // future event set, again behind the end of the transmission
+    simtime_t finishTime = start + (overhead + cut + MCRC_BYTES) * 8 / txrate;
+    simtime_t propagationDelay = fragment->getArrivalTime() - start - fragment->getDuration();
+    simulation.msgQueue.remove(fragment);
+    cancelEvent(endTxMsg);
+    scheduleAt(finishTime, endTxMsg);
+    EtherFrame *frame = check_and_cast<EtherFrame *>(fragment->decapsulate());
+    fragment->setByteLength(overhead + cut + MCRC_BYTES);
+    fragment->setMCRC(true);
+    fragment->setDuration(finishTime - start);
+    fragment->setArrivalTime(finishTime + propagationDelay);
+    simulation.msgQueue.insert(fragment);
+    transmissionChannel->forceTransmissionFinishTime(finishTime);
+
+    txBytesSent -= txMPacketBytes - cut;
+    txMPacketBytes = cut;
+    holdPreemptedFrame(frame);
+}
+
+void EtherMACFullDuplex::holdPreemptedFrame(EtherFrame *frame)
+{
+    // its class keeps transmitting until the end of the mCRC
+    EV_HOT << "Preempting " << frame << " after " << txBytesSent << " bytes\n";
+    numPreemptions++;
+    preemptedFrame = frame;
+    preemptedClass = curTxClass;
+    preemptedTxMetadata = txMetadata;
+    preemptedTxMetadata.frame = txMetadata.frame = NULL;
+    txSendingMCRC = true;
+}
+
+bool EtherMACFullDuplex::handleEndOfSlice()
+{
+    if (txSendingMCRC)
+    {
+        // end of the preempted mPacket: the express frame is selected after the IFG
+        if (cbsEnabled)
+            updateCredits();    // the preempted class stops transmitting
+        curTxClass = -1;
+        txSendingMCRC = false;
+        txSliced = false;
+        txMPacket = NULL;
+        lastTxFinishTime = simTime();
         scheduleEndIFGPeriod();
+        return false;
+    }
+
+    if (txBytesSent == txFrameBytes)
+    {
+        // last mPacket or slice sent: the frame is completed as usual
+        if (txMPacket)
+            emitTxSignals(txMetadata.frame, simTime());
+        txSliced = false;
+        txMPacket = NULL;
+        return true;
+    }
+
+    // only when sending in slices
+    if (txMPacketBytes >= MIN_FRAGMENT_BYTES && txFrameBytes - txBytesSent >= MIN_FRAGMENT_BYTES && isExpressFrameWaiting())
+    {
+        EtherFrame *frame = curTxFrame;
+        curTxFrame = NULL;
+        holdPreemptedFrame(frame);
+
+        EtherFragment *crc = new Pooled<EtherFragment>("mCRC");
+        crc->setFrameId(frame->getId());
+        crc->setFragmentNumber(txFragmentNumber);
+        crc->setMCRC(true);
+        crc->setByteLength(MCRC_BYTES);
+        send(crc, physOutGate);
+
+        scheduleAt(transmissionChannel->getTransmissionFinishTime(), endTxMsg);
+        return false;
+    }
+
+    sendNextSlice();
+    return false;
+}
+
+void EtherMACFullDuplex::processReceivedFragment(EtherFragment *fragment)
+{
+    totalSuccessfulRxTime += fragment->getDuration();
+
+    bool continued = fragment->getFrameId() == rxFragmentFrameId;
+    if (!continued)
+    {
+        rxFragmentFrameId = fragment->getFrameId();
+        rxFragmentBitError = false;
+    }
+    if (fragment->hasBitError())
+        rxFragmentBitError = true;
+
+    if (!fragment->getEncapsulatedPacket())
+    {
+        delete fragment;
+        return;
     }
+
+    // last slice: the frame is processed as if it had arrived whole
+    EtherFrame *frame = check_and_cast<EtherFrame *>(fragment->decapsulate());
+    if (rxFragmentBitError)
+        frame->setBitError(true);
+    rxFragmentFrameId = -1;
+    if (continued)
+        numReassembledFrames++;     // not a preemptable frame received whole
+    delete fragment;
+
+    processMsgFromNetwork(frame);
 }
 
 void EtherMACFullDuplex::finish()
@@ -541,6 +1520,64 @@ void EtherMACFullDuplex::finish()
     simtime_t totalRxChannelIdleTime = t - totalSuccessfulRxTime;
     recordScalar("rx channel idle (%)", 100 * (totalRxChannelIdleTime / t));
     recordScalar("rx channel utilization (%)", 100 * (totalSuccessfulRxTime / t));
+
+    if (tasEnabled)
+    {
+        recordScalar("frames waiting for a gate", numGateWaits);
+        recordScalar("frames dropped by the guard band", numGuardBandDrops);
+    }
+    if (framePreemption)
+    {
+        recordScalar("preemptions", numPreemptions);
+        recordScalar("fragments sent", numFragmentsSent);
+    }
+    if (numReassembledFrames > 0)
+        recordScalar("reassembled frames", numReassembledFrames);
+    if (cutThrough)
+    {
+        recordScalar("cut-through frames", numCutThroughFrames);
+        recordScalar("cut-through frames with bad FCS", numCutThroughBitErrors);
+    }
+    profiler.recordScalars(this);
+    if (residenceTime)
+        residenceTime->recordAs(this, "residence time", 1e-9, "s");
+    for (unsigned int vlId = 0; vlId < vlLatency.size(); vlId++)
+    {
+        if (!vlLatency[vlId])
+            continue;
+        char name[48];
+        sprintf(name, "vl_%u end-to-end latency", vlId);
+        vlLatency[vlId]->latency.recordAs(this, name, 1e-9, "s");
+        sprintf(name, "vl_%u jitter", vlId);
+        vlLatency[vlId]->jitter.recordAs(this, name, 1e-9, "s");
+        sprintf(name, "vl_%u peak-to-peak jitter", vlId);
+        recordScalar(name, (vlLatency[vlId]->latency.getMax() - vlLatency[vlId]->latency.getMin()) * 1e-9, "s");
+    }
+    if (cbsEnabled)
+        recordScalar("frames waiting for credit", numCreditWaits);
+    if (burstMode)
+    {
+        recordScalar("bursts", numBursts);
+        recordScalar("frames sent in bursts", numBurstFrames);
+        recordScalar("burst interruptions", numBurstInterruptions);
+    }
+    recordScalar("frames dropped by queue overflow", numDroppedQueueOverflow);
+    if (classQueuing)
+    {
+        for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+        {
+            char name[32];
+            if (numOverflowDrops[tc] > 0)
+            {
+                sprintf(name, "dropped frames tc%d", tc);
+                recordScalar(name, numOverflowDrops[tc]);
+            }
+            if (classDelay[tc].getCount() == 0)
+                continue;
+            sprintf(name, "tx delay tc%d", tc);
+            classDelay[tc].recordAs(name, "s");
+        }
+    }
 }
 
 void EtherMACFullDuplex::handleEndPausePeriod()
@@ -565,12 +1602,44 @@ void EtherMACFullDuplex::processReceivedDataFrame(EtherFrame *frame)
     numBytesReceivedOK += curBytes;
     emit(rxPkOkSignal, frame);
 
+    if (recordLatency)
+    {
+        if (switchPort)
+            frame->setTimestamp();      // ingress time, for the residence time at the egress port
+        else
+        {
+            int vlId = VLTable::parseVLId(frame->getName());
+            if (vlId >= 0)
+                recordEndToEndLatency(vlId, frame);
+        }
+    }
+
     numFramesPassedToHL++;
     emit(packetSentToUpperSignal, frame);
     // pass up to upper layer
     send(frame, "upperLayerOut");
 }
 
+void EtherMACFullDuplex::recordEndToEndLatency(int vlId, EtherFrame *frame)
+{
+    if (vlId >= (int)vlLatency.size())
+        vlLatency.resize(vlId + 1, NULL);
+    VLLatency *stats = vlLatency[vlId];
+    if (!stats)
+        stats = vlLatency[vlId] = new VLLatency();
+
+    // the frame is created at the source station; the copies made by the
+    // switches (flooding) keep its creation time, and the payload is not touched
+    simtime_t latency = simTime() - frame->getCreationTime();
+    stats->latency.collect(toNanoseconds(latency));
+    if (stats->latency.getCount() > 1)
+    {
+        simtime_t variation = latency - stats->lastLatency;
+        stats->jitter.collect(toNanoseconds(variation < SIMTIME_ZERO ? -variation : variation));
+    }
+    stats->lastLatency = latency;
+}
+
 void EtherMACFullDuplex::processPauseCommand(int pauseUnits)
 {
     if (transmitState == TX_IDLE_STATE)
@@ -594,6 +1663,20 @@ void EtherMACFullDuplex::processPauseCommand(int pauseUnits)
         // and then it'll go to PAUSE state
         EV << "PAUSE frame received, storing pause request\n";
         pauseUnitsRequested = pauseUnits;
+
+        if (!burst.empty())
+        {
+            // the frames after the current one wait for the PAUSE period
+            if (pauseUnits > 0)
+                interruptBurst(true, true);
+        }
+        else if (txIFGFolded && simTime() <= txFinishTime)
+        {
+            // the PAUSE period starts at the end of the frame, not of the IFG
+            cancelEvent(endTxMsg);
+            scheduleAt(txFinishTime, endTxMsg);
+            txIFGFolded = false;
+        }
     }
 }
 
@@ -614,20 +1697,24 @@ void EtherMACFullDuplex::scheduleEndPausePeriod(int pauseUnits)
 
 void EtherMACFullDuplex::beginSendFrames()
 {
+    if (!curTxFrame && classQueuing)
+        selectFrameForTransmission();
+
     if (curTxFrame)
     {
         // Other frames are queued, transmit next frame
-        EV << "Transmit next frame in output queue\n";
+        EV_HOT << "Transmit next frame in output queue\n";
         startFrameTransmission();
     }
     else
     {
         // No more frames set transmitter to idle
         transmitState = TX_IDLE_STATE;
+
         if (!txQueue.extQueue){
             // Output only for internal queue (we cannot be shure that there
             //are no other frames in external queue)
-            EV << "No more frames to send, transmitter set to idle\n";
+            EV_HOT << "No more frames to send, transmitter set to idle\n";
         }
     }
 }
@@ -0,0 +1,302 @@
+#ifndef __INET_ETHER_DUPLEX_MAC_H
+#define __INET_ETHER_DUPLEX_MAC_H
+
+#include <string>
+
+#include "INETDefs.h"
+
+#include "EtherMACBase.h"
+#include "VLTable.h"
+#include "ScheduleStore.h"
+#include "GateControlList.h"
+#include "EtherFragment_m.h"
+#include "LogLinearHistogram.h"
+#include "HandlerProfiler.h"
+
+/**
+ * A simplified version of EtherMAC. Since modern Ethernets typically
+ * operate over duplex links where's no contention, the original CSMA/CD
+ * algorithm is no longer needed. This simplified implementation doesn't
+ * contain CSMA/CD, frames are just simply queued up and sent out one by one.
+ *
+ * En los switches de la red del vehículo además se identifican los flujos
+ * (VLs) recibidos y se reconfiguran las ventanas correspondientes según la
+ * tabla de VLs (parámetro vlConfig).
+ *
+ * If the gateControlList parameter contains a gate control list, the MAC
+ * acts as an IEEE 802.1Qbv time-aware shaper: frames are queued per traffic
+ * class (see the trafficClasses parameter) and a frame is only started if
+ * the gate of its class is open and stays open until the end of the frame
+ * (guard band). The highest class with an eligible frame is served first.
+ * PAUSE frames are not subject to the gates.
+ *
+ * With framePreemption (IEEE 802.3br / 802.1Qbu) the classes listed in
+ * expressClasses are express traffic and the rest preemptable. A preemptable
+ * frame is sent whole, as one mPacket (EtherFragment). When an express frame
+ * becomes eligible during it (arrival, or its gate opening), the mPacket is
+ * cut at the next 8-byte boundary, provided that both the sent and the
+ * remaining part are at least 64 bytes, and closed with the mCRC. The
+ * preempted frame is resumed, as a continuation fragment that may be cut in
+ * turn, before any other preemptable frame. The mPacket is cut while it is in
+ * the future event set, so if the receiver gets frames at the start of their
+ * reception (cut-through) or is in another partition, the frame is sent in
+ * slices of preemptionSliceBytes instead and preempted at the end of a
+ * slice. Fragments are reassembled on reception regardless of the local
+ * settings.
+ *
+ * With priorityQueuing (or implicitly with any of the above) the frames are
+ * held in eight traffic-class queues and the highest class with an eligible
+ * frame is always sent first. Frames are classified by VL id (trafficClasses
+ * parameter). A class may additionally be shaped by an IEEE 802.1Qav
+ * credit-based shaper (<shaper class idleSlope/> elements in trafficClasses):
+ * its frames are only started while its credit is not negative. A full class
+ * queue drops the arriving frame and counts it, like a full internal queue.
+ *
+ * With cutThrough the MAC receives frames at the start of reception and
+ * hands them up as soon as the Ethernet header has arrived, so the relay
+ * forwards them and the egress MAC starts sending while the frame is still
+ * being received. The FCS cannot be checked at that point: frames with bit
+ * errors are forwarded and counted, and dropped by the next store-and-forward
+ * MAC. Cut-through is meant for switch ports, and assumes that the egress
+ * links are not faster than the ingress link.
+ *
+ * With recordLatency the MAC keeps fixed-memory histograms (LogLinearHistogram)
+ * and records their percentiles at finish(). In a switch port it stamps
+ * received frames with the ingress time (the frame timestamp is overwritten)
+ * and, when a VL frame starts being sent, records the residence time in the
+ * switch. In an end station it records, per received VL, the end-to-end
+ * latency since the creation of the frame at the source station and the
+ * jitter as the difference between consecutive latencies (RFC 3393 IPDV).
+ *
+ * With foldIFG the end of a transmission and the following interframe gap
+ * take a single event, at the end of the gap. The end-of-transmission
+ * signals are then emitted as timestamped values carrying the end of the
+ * frame, so the recorded vectors are the same. A PAUSE frame received
+ * during the transmission unfolds it; folding is not used together with
+ * the credit-based shaper or for frames sent in preemption slices.
+ *
+ * With burstMode, starting a frame also takes up to maxBurstFrames - 1
+ * further queued frames, in the order they would be selected, and computes
+ * their departure times (back to back, separated by the IFG). They are sent
+ * right away with sendDelayed(), so there are no departure, end-of-transmission
+ * or IFG events in between, and the whole burst ends with one event where the
+ * statistics of all its frames are emitted with their own timestamps. The
+ * frames whose departure is still in the future are taken back from the
+ * future event set and requeued when a PAUSE frame is received, a PAUSE frame
+ * or a frame of a higher traffic class arrives from the upper layer, or the
+ * link changes datarate, and dropped when the link is cut. If the receiver is
+ * in another partition of a parallel simulation, where a send cannot be taken
+ * back, the frames stay in the MAC and a timer sends each one at its
+ * departure. Bursts are not used with the gates, the credit-based shaper,
+ * frame preemption or an external queue.
+ */
+class INET_API EtherMACFullDuplex : public EtherMACBase
+{
+  public:
+    EtherMACFullDuplex();
+    virtual ~EtherMACFullDuplex();
+
+  protected:
+    virtual void initialize(int stage);
+    virtual void initializeStatistics();
+    virtual void initializeFlags();
+    virtual void handleMessage(cMessage *msg);
+    virtual void receiveSignal(cComponent *src, simsignal_t signalId, cObject *obj);
+    virtual void processConnectDisconnect();
+    virtual void finish();
+
+    // event handlers
+    virtual void handleEndIFGPeriod();
+    virtual void handleEndTxPeriod();
+    virtual void handleEndPausePeriod();
+    virtual void handleReselect();
+    virtual void handleSelfMessage(cMessage *msg);
+
+    // helpers
+    virtual void startFrameTransmission();
+    virtual void captureTxMetadata(EtherFrame *frame);
+    virtual void prepareFrameForSending(EtherFrame *frame);
+    virtual void emitTxSignals(EtherFrame *frame, simtime_t endTime);
+    virtual void recordEndOfTransmission(simtime_t endTime);
+    virtual void dropFrameOnWire();
+    virtual void emitAtTxEnd(simsignal_t signal, cObject *obj, simtime_t endTime);
+    virtual void emitAtTxEnd(simsignal_t signal, long l, simtime_t endTime);
+    virtual void processFrameFromUpperLayer(EtherFrame *frame);
+    virtual void processMsgFromNetwork(EtherTraffic *msg);
+    virtual void processReceivedDataFrame(EtherFrame *frame);
+    virtual void processPauseCommand(int pauseUnits);
+    virtual void scheduleEndIFGPeriod();
+    virtual void scheduleEndPausePeriod(int pauseUnits);
+    virtual void beginSendFrames();
+
+    // reconfiguración de ventanas del VL recibido
+    virtual void reconfigureVLWindows(const VLEntry *vl);
+
+    // cut-through
+    virtual void processCutThroughHeader(EtherTraffic *msg);
+
+    // latency statistics
+    virtual bool isSwitchPort();
+    virtual void recordEndToEndLatency(int vlId, EtherFrame *frame);
+
+    // per-class queuing and time-aware shaper
+    virtual void loadTrafficClasses(cXMLElement *classes);
+    virtual int classifyFrame(EtherFrame *frame);
+    virtual simtime_t getTransmissionDuration(EtherFrame *frame);
+    virtual bool selectFrameForTransmission();
+    virtual void scheduleReselect(simtime_t wakeUp);
+    virtual void dropOverflowFrame(EtherFrame *frame, int trafficClass);
+
+    // credit-based shaper
+    virtual void updateCredits();
+
+    // burst transmission
+    struct BurstFrame;
+    virtual void startBurst();
+    virtual EtherFrame *takeBurstFrame(int& trafficClass);
+    virtual void handleBurstDeparture();
+    virtual bool hasDeparted(const BurstFrame& entry);
+    virtual void interruptBurst(bool endAtFrame, bool keepNextInIFG);
+    virtual void truncateBurst(unsigned int length, bool endAtFrame);
+    virtual void revokeBurstFrame(BurstFrame& entry);
+    virtual void requeueBurstFrames(unsigned int from);
+    virtual void checkBurstLink();
+
+    // frame preemption
+    bool isExpressClass(int trafficClass) const { return (expressClasses >> trafficClass) & 1; }
+    virtual bool isExpressFrameWaiting();
+    virtual bool canPreemptOnDemand();
+    virtual void sendNextSlice();
+    virtual void checkPreemption();
+    virtual void preemptMPacket();
+    virtual void holdPreemptedFrame(EtherFrame *frame);
+    virtual bool handleEndOfSlice();
+    virtual void processReceivedFragment(EtherFragment *fragment);
+
+    bool hotPathLogging;    // per-frame log statements enabled (see HotPathLog.h)
+
+    // handlers measured by the profiler (profileHandlers parameter)
+    enum { PROFILE_SELF_MESSAGE, PROFILE_UPPER_LAYER, PROFILE_NETWORK, PROFILE_CUT_THROUGH, NUM_PROFILED_HANDLERS };
+    HandlerProfiler profiler;
+
+    // statistics
+    simtime_t totalSuccessfulRxTime; // total duration of successful transmissions on channel
+
+    // the frame under transmission is sent itself, not a copy: the receiver
+    // may consume it before the end of the transmission, so its signals are
+    // emitted when it is handed to the channel (see emitTxSignals()) and the
+    // rest of the end-of-transmission statistics use what is kept here
+    struct TxMetadata
+    {
+        bool isPauseFrame;
+        int pauseUnits;
+        int64 byteLength;       // as queued (padded to the Ethernet minimum, without preamble and SFD)
+        int64 frameByteLength;
+        int vlId;               // -1 if the frame is not a VL
+        simtime_t arrivalTime;  // at the MAC
+        EtherFrame *frame;      // once sent: only valid before frameArrival (in the FES until then)
+        simtime_t frameArrival; // at the receiving MAC
+    };
+    TxMetadata txMetadata;
+    TxMetadata preemptedTxMetadata;     // of preemptedFrame
+    bool txMetadataValid;
+
+    // end of transmission and IFG in a single event (foldIFG parameter)
+    bool foldIFG;
+    bool txIFGFolded;                   // endTxMsg is scheduled at the end of the IFG
+    simtime_t txFinishTime;             // end of the frame on the wire
+
+    // burst transmission (burstMode parameter)
+    struct BurstFrame
+    {
+        EtherFrame *frame;          // burstDelayed: sent, in the FES until its departure;
+                                    // otherwise owned by the MAC until then, NULL once sent
+        EtherFrame *statFrame;      // burstDelayed: copy for the signals at the end of the burst
+        TxMetadata metadata;
+        int trafficClass;
+        simtime_t departureTime;
+        simtime_t finishTime;
+    };
+    bool burstMode;
+    int maxBurstFrames;
+    std::vector<BurstFrame> burst;      // frames of the burst in progress, in sending order
+    bool burstDelayed;                  // frames sent ahead with sendDelayed(), no departure timer
+    unsigned int burstNext;             // next frame of the burst to depart, without burstDelayed
+    cMessage *burstDepartureMsg;        // departure of burst[burstNext], without burstDelayed
+    bool burstEndFolded;                // endTxMsg is at the end of the IFG after the burst
+    double burstTxrate;                 // datarate the departure times were computed for
+    long numBursts;
+    long numBurstFrames;
+    long numBurstInterruptions;
+
+    // tabla de VLs del switch que contiene a esta interfaz
+    VLTable vlTable;
+    cModule *controlModule;     // módulo appControl del switch
+    ScheduleStore *scheduleStore;   // ventanas de los VLs del switch
+
+    // latency statistics, in nanoseconds
+    struct VLLatency
+    {
+        LogLinearHistogram latency;
+        LogLinearHistogram jitter;      // |latency - latency of the previous frame|
+        simtime_t lastLatency;
+    };
+    bool recordLatency;
+    bool switchPort;                    // the MAC is a port of a relay
+    std::vector<VLLatency *> vlLatency; // indexed by VL id, NULL until the VL is received
+    LogLinearHistogram *residenceTime;  // switch ports only
+
+    // cut-through forwarding
+    bool cutThrough;
+    long numCutThroughFrames;
+    long numCutThroughBitErrors;       // frames forwarded before their bad FCS was known
+
+    // per-class queuing, used by strict priority, the shapers and frame preemption
+    bool classQueuing;
+    cPacketQueue classQueue[NUM_TRAFFIC_CLASSES];
+    int classQueueLimit;
+    std::vector<int> vlTrafficClass;    // traffic class of each VL, indexed by VL id
+    int defaultTrafficClass;            // class of the frames that are not VLs
+    int curTxClass;                     // traffic class of curTxFrame, -1 for MAC control frames
+    cMessage *reselectMsg;              // scheduled while frames wait for a gate or for credit
+    cStdDev classDelay[NUM_TRAFFIC_CLASSES];    // arrival at the MAC -> end of transmission
+    long numOverflowDrops[NUM_TRAFFIC_CLASSES];
+    long numDroppedQueueOverflow;       // all classes and the internal queue
+    static simsignal_t dropPkQueueOverflowSignal;
+
+    // time-aware shaper (IEEE 802.1Qbv)
+    bool tasEnabled;
+    GateControlList gateControlList;
+    long numGateWaits;
+    long numGuardBandDrops;
+
+    // credit-based shaper (IEEE 802.1Qav)
+    bool cbsEnabled;
+    double idleSlope[NUM_TRAFFIC_CLASSES];  // bit/s, 0 if the class is not shaped
+    double credit[NUM_TRAFFIC_CLASSES];     // bits
+    simtime_t creditUpdateTime;
+    long numCreditWaits;
+
+    // frame preemption (IEEE 802.3br / 802.1Qbu)
+    bool framePreemption;
+    unsigned char expressClasses;       // bit i: traffic class i is express
+    int preemptionSliceBytes;
+    bool txSliced;                      // the frame is being sent in mPackets
+    bool txOnDemand;                    // the current mPacket carries the rest of the frame, cut on demand
+    EtherFragment *txMPacket;           // with txOnDemand: the mPacket on the wire, in the FES until its end
+    bool txSendingMCRC;                 // the mCRC of a preempted mPacket is being sent
+    bool txResuming;                    // curTxFrame continues a preempted frame
+    EtherFrame *preemptedFrame;
+    int preemptedClass;
+    long txFrameBytes;                  // bytes of the fragmented frame (padded, without preamble)
+    long txBytesSent;                   // bytes of the frame already sent
+    long txMPacketBytes;                // bytes of the frame sent in the current mPacket
+    int txFragmentNumber;
+    long rxFragmentFrameId;             // frame being reassembled, -1 if none
+    bool rxFragmentBitError;
+    long numPreemptions;
+    long numFragmentsSent;
+    long numReassembledFrames;
+};
+
+#endif
@@ -1,18 +1,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdlib.h>
 
 #include "EtherTrafGen.h"
 
 #include "Ieee802Ctrl_m.h"
 #include "NodeOperations.h"
 #include "ModuleAccess.h"
+#include "ObjectPool.h"
 
 Define_Module(EtherTrafGen);
 
 simsignal_t EtherTrafGen::sentPkSignal = registerSignal("sentPk");
 simsignal_t EtherTrafGen::rcvdPkSignal = registerSignal("rcvdPk");
 
+static const char *profiledHandlerNames[] = { "handleSelfMessage", "relayConfiguration" };
+
 EtherTrafGen::EtherTrafGen()
 {
     sendInterval = NULL;
@@ -36,7 +40,6 @@ void EtherTrafGen::initialize(int stage)
         sendInterval = &par("sendInterval");
         numPacketsPerBurst = &par("numPacketsPerBurst");
         packetLength = &par("packetLength");
-        etherType = par("etherType");
 
         seqNum = 0;
         WATCH(seqNum);
@@ -50,6 +53,12 @@ void EtherTrafGen::initialize(int stage)
         stopTime = par("stopTime");
         if (stopTime >= SIMTIME_ZERO && stopTime < startTime)
             error("Invalid startTime/stopTime parameters");
+
+        // tabla de reenvío de las configuraciones entre switches
+        loadConfigRoutes(par("configRoutes").xmlValue());
+
+        if (par("profileHandlers").boolValue())
+            profiler.enable(profiledHandlerNames, NUM_PROFILED_HANDLERS);
     }
     else if (stage == 3)
     {
@@ -68,6 +77,7 @@ void EtherTrafGen::handleMessage(cMessage *msg)
         throw cRuntimeError("Application is not running");
     if (msg->isSelfMessage())
     {
+        PROFILE_HANDLER(profiler, PROFILE_SELF_MESSAGE, msg->getKind());
         if (msg->getKind() == START)
         {
             
@@ -76,43 +86,71 @@ void EtherTrafGen::handleMessage(cMessage *msg)
     }
     else{
 
-         // Se obtiene la información proveniente del módulo appControl
-
-         const char *mensaje = msg->getArrivalGate()->getFullName();
-         const char *nombre = msg->getName();
-
-         // Se identifica el Switch desde el cual se envía el mensaje
-
-         if(strcmp(mensaje,"in[3]")==0){
-
-            // Se envía la configuración al Switch 2 
-
-             sendConfiguration(nombre,1);
-
-             // Si corresponde al nodo señalizador se realiza un reajuste en la configuración recibida
-
-             int tiempo=0;
-             char name[40];
-             char nombremoduloout[10];
-             char nuevonombre[40];
+         PROFILE_HANDLER(profiler, PROFILE_CONFIGURATION, msg->getKind());
 
-            // Se envía la configuración al Switch 3 
+         // Se obtiene la información proveniente del módulo appControl
 
-             sscanf(msg->getName(), "%s %s %d", name, nombremoduloout, &tiempo);
-             sprintf(nuevonombre, "%s %s %d", name, nombremoduloout, tiempo+21);
-             sendConfiguration(nuevonombre,2);
+         VLConfigPacket *config = check_and_cast<VLConfigPacket *>(msg);
+         // la información de control recibida se reutiliza para la última copia
+         Ieee802Ctrl *receivedCtrl = dynamic_cast<Ieee802Ctrl *>(config->getControlInfo());
+         if (receivedCtrl)
+             config->removeControlInfo();
+         else
+             delete config->removeControlInfo();
+
+         // Se identifica el Switch desde el cual se envía el mensaje y se reenvía la configuración
+         // a los Switches indicados en la tabla configRoutes, con el reajuste correspondiente
+
+         int in = msg->getArrivalGate()->getIndex();
+         if (in >= (int)configRoutes.size() || configRoutes[in].empty())
+         {
+             EV << "No configuration route for gate in[" << in << "], dropping " << msg << "\n";
+             delete receivedCtrl;
+             delete config;
+             return;
          }
 
-        // Si el Switch que envía la configuración es el número 2, se envía la configuración al Switch 1 y 3
-
-         else if(strcmp(mensaje,"in[4]")==0){
-             sendConfiguration(nombre,0);
-             sendConfiguration(nombre,2);
-
+         const std::vector<ConfigRoute>& routes = configRoutes[in];
+         int baseOffset = config->getHopOffset();
+         for (unsigned int i = 0; i < routes.size(); i++)
+         {
+             VLConfigPacket *copy = (i + 1 < routes.size()) ? config->dup() : config;
+             copy->setHopOffset(baseOffset + routes[i].hopOffset);
+             sendConfiguration(copy, routes[i].gate, (i + 1 < routes.size()) ? NULL : receivedCtrl);
          }
     }
+}
 
+void EtherTrafGen::loadConfigRoutes(cXMLElement *routesElement)
+{
+    configRoutes.clear();
+    if (!routesElement)
+        return;
 
+    int numOutGates = gateSize("out");
+    cXMLElementList routes = routesElement->getChildrenByTagName("route");
+    for (cXMLElementList::iterator it = routes.begin(); it != routes.end(); it++)
+    {
+        const char *inAttr = (*it)->getAttribute("in");
+        if (!inAttr)
+            throw cRuntimeError("Route without 'in' attribute at %s", (*it)->getSourceLocation());
+        int in = atoi(inAttr);
+        if (in >= (int)configRoutes.size())
+            configRoutes.resize(in + 1);
+
+        cXMLElementList outs = (*it)->getChildrenByTagName("out");
+        for (cXMLElementList::iterator o = outs.begin(); o != outs.end(); o++)
+        {
+            const char *gateAttr = (*o)->getAttribute("gate");
+            const char *offsetAttr = (*o)->getAttribute("hopOffset");
+            ConfigRoute route;
+            route.gate = gateAttr ? atoi(gateAttr) : -1;
+            route.hopOffset = offsetAttr ? atoi(offsetAttr) : 0;
+            if (route.gate < 0 || route.gate >= numOutGates)
+                throw cRuntimeError("Invalid output gate in route at %s", (*o)->getSourceLocation());
+            configRoutes[in].push_back(route);
+        }
+    }
 }
 
 bool EtherTrafGen::handleOperationStage(LifecycleOperation *operation, int stage, IDoneCallback *doneCallback)
@@ -151,23 +189,26 @@ void EtherTrafGen::cancelNextPacket()
 }
 
 
-void EtherTrafGen::sendConfiguration(const char *mensaje, int gate){
+void EtherTrafGen::sendConfiguration(VLConfigPacket *config, int gate, Ieee802Ctrl *etherctrl){
 
-    // Se generan los paquetes que contienen la información de configuración
+    // Se reenvían los paquetes que contienen la información de configuración
 
-    EV << "Generating packet `" << mensaje << "'\n";
+    EV << "Sending configuration of VL " << config->getVlId() << " to gate " << gate << "\n";
 
-    cPacket *datapacket = new cPacket(mensaje, IEEE802CTRL_DATA);
     long len = packetLength->longValue();
-    datapacket->setByteLength(len);
-
-    Ieee802Ctrl *etherctrl = new Ieee802Ctrl();
-    etherctrl->setEtherType(etherType);
+    config->setKind(IEEE802CTRL_DATA);
+    config->setByteLength(len);
+
+    if (etherctrl)
+        *etherctrl = Ieee802Ctrl();     // se reinician los campos de la información reutilizada
+    else
+        etherctrl = new Pooled<Ieee802Ctrl>();
+    etherctrl->setEtherType(ETHERTYPE_VL_CONFIG);
     etherctrl->setDest(destMACAddress);
-    datapacket->setControlInfo(etherctrl);
+    config->setControlInfo(etherctrl);
 
-    emit(sentPkSignal, datapacket);
-    send(datapacket, "out" , gate);
+    emit(sentPkSignal, config);
+    send(config, "out" , gate);
 }
 
 void EtherTrafGen::receivePacket(cPacket *msg)
@@ -181,6 +222,7 @@ void EtherTrafGen::receivePacket(cPacket *msg)
 
 void EtherTrafGen::finish()
 {
+    profiler.recordScalars(this);
     cancelAndDelete(timerMsg);
     timerMsg = NULL;
 }
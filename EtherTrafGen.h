@@ -0,0 +1,81 @@
+#ifndef __INET_ETHERTRAFGEN_H
+#define __INET_ETHERTRAFGEN_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+#include "NodeStatus.h"
+#include "ILifecycle.h"
+#include "VLConfig_m.h"
+#include "HandlerProfiler.h"
+#include "Ieee802Ctrl_m.h"
+
+/**
+ * Simple traffic generator for the Ethernet model.
+ *
+ * En la red del vehículo cumple la función de módulo de gestión de tráfico:
+ * redistribuye a los switches los paquetes de configuración recibidos.
+ */
+class INET_API EtherTrafGen : public cSimpleModule, public ILifecycle
+{
+  protected:
+    enum Kinds {START=100, NEXT};
+
+    long seqNum;
+
+    // send parameters
+    cPar *sendInterval;
+    cPar *numPacketsPerBurst;
+    cPar *packetLength;
+    MACAddress destMACAddress;
+    NodeStatus *nodeStatus;
+
+    // reenvío de configuraciones: por cada gate de entrada, gates de salida
+    // y desplazamiento que se agrega a la configuración
+    struct ConfigRoute
+    {
+        int gate;
+        int hopOffset;
+    };
+    std::vector<std::vector<ConfigRoute> > configRoutes;
+
+    // handlers measured by the profiler (profileHandlers parameter)
+    enum { PROFILE_SELF_MESSAGE, PROFILE_CONFIGURATION, NUM_PROFILED_HANDLERS };
+    HandlerProfiler profiler;
+
+    // self messages
+    cMessage *timerMsg;
+    simtime_t startTime;
+    simtime_t stopTime;
+
+    // receive statistics
+    long packetsSent;
+    long packetsReceived;
+    static simsignal_t sentPkSignal;
+    static simsignal_t rcvdPkSignal;
+
+  public:
+    EtherTrafGen();
+    virtual ~EtherTrafGen();
+
+    virtual bool handleOperationStage(LifecycleOperation *operation, int stage, IDoneCallback *doneCallback);
+
+  protected:
+    virtual void initialize(int stage);
+    virtual int numInitStages() const { return 4; }
+    virtual void handleMessage(cMessage *msg);
+    virtual void finish();
+
+    virtual bool isNodeUp();
+    virtual bool isGenerator();
+    virtual void scheduleNextPacket(simtime_t previous);
+    virtual void cancelNextPacket();
+
+    virtual void loadConfigRoutes(cXMLElement *routes);
+    virtual void sendConfiguration(VLConfigPacket *config, int gate, Ieee802Ctrl *etherctrl);
+    virtual void receivePacket(cPacket *msg);
+};
+
+#endif
@@ -0,0 +1,427 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "FlatMACAddressTable.h"
+
+Define_Module(FlatMACAddressTable);
+
+FlatMACAddressTable::FlatMACAddressTable()
+{
+    slotMask = 0;
+    hashShift = 64;
+    freeList = -1;
+    numEntries = 0;
+    currentTick = 0;
+    numLearned = numAged = numGrows = 0;
+    for (int i = 0; i < WHEEL0_SIZE + WHEEL1_SIZE; i++)
+        buckets[i] = -1;
+}
+
+void FlatMACAddressTable::initialize()
+{
+    agingTime = defaultAgingTime = par("agingTime");
+    if (agingTime <= SIMTIME_ZERO)
+        error("Invalid agingTime parameter");
+    tickLength = defaultAgingTime / TICKS_PER_AGING_TIME;
+    currentTick = tickOf(simTime());
+
+    int capacity = par("initialCapacity");
+    unsigned int numSlots = 16;
+    while (numSlots * 3 / 4 < (unsigned int)capacity)
+        numSlots *= 2;
+    resize(numSlots);
+
+    loadStaticEntries(par("staticEntries").xmlValue());
+
+    WATCH(numEntries);
+    WATCH(numLearned);
+    WATCH(numAged);
+}
+
+void FlatMACAddressTable::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("This module doesn't process messages");
+}
+
+void FlatMACAddressTable::loadStaticEntries(cXMLElement *config)
+{
+    if (!config)
+        return;
+
+    cXMLElementList list = config->getChildrenByTagName("entry");
+    for (cXMLElementList::iterator it = list.begin(); it != list.end(); it++)
+    {
+        const char *address = (*it)->getAttribute("address");
+        const char *port = (*it)->getAttribute("port");
+        const char *vid = (*it)->getAttribute("vid");
+        if (!address || !port)
+            throw cRuntimeError("Static entry needs address and port attributes at %s", (*it)->getSourceLocation());
+
+        MACAddress mac(address);
+        uint64 key = makeKey(mac, vid ? atoi(vid) : 0);
+        int index = findEntry(key);
+        if (index >= 0)
+            remove(index);
+        insert(key, atoi(port), true);
+    }
+}
+
+void FlatMACAddressTable::resize(unsigned int numSlots)
+{
+    // the pool keeps the load factor of the hash array at 3/4
+    unsigned int poolSize = numSlots * 3 / 4;
+    if (entries.size() < poolSize)
+    {
+        Entry empty;
+        empty.key = NO_KEY;
+        empty.portno = -1;
+        empty.isStatic = false;
+        empty.expiryTick = 0;
+        empty.slot = -1;
+        empty.bucket = -1;
+        empty.prev = -1;
+        for (int i = entries.size(); i < (int)poolSize; i++)
+        {
+            empty.next = freeList;
+            entries.push_back(empty);
+            freeList = i;
+        }
+    }
+
+    slots.assign(numSlots, -1);
+    slotMask = numSlots - 1;
+    hashShift = 64;
+    for (unsigned int n = numSlots; n > 1; n >>= 1)
+        hashShift--;
+
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+        Entry& entry = entries[i];
+        if (entry.key == NO_KEY)
+            continue;
+        unsigned int slot = home(entry.key);
+        while (slots[slot] >= 0)
+            slot = (slot + 1) & slotMask;
+        slots[slot] = i;
+        entry.slot = slot;
+    }
+}
+
+int FlatMACAddressTable::insert(uint64 key, int portno, bool isStatic)
+{
+    if (freeList < 0)
+    {
+        numGrows++;
+        resize(slots.size() * 2);
+    }
+
+    int index = freeList;
+    Entry& entry = entries[index];
+    freeList = entry.next;
+
+    entry.key = key;
+    entry.portno = portno;
+    entry.isStatic = isStatic;
+    entry.insertionTime = simTime();
+    entry.prev = entry.next = -1;
+
+    unsigned int slot = home(key);
+    while (slots[slot] >= 0)
+        slot = (slot + 1) & slotMask;
+    slots[slot] = index;
+    entry.slot = slot;
+
+    numEntries++;
+    if (!isStatic)
+    {
+        entry.expiryTick = tickOf(entry.insertionTime + agingTime);
+        schedule(index);
+    }
+    return index;
+}
+
+void FlatMACAddressTable::remove(int index)
+{
+    Entry& entry = entries[index];
+    if (entry.bucket >= 0)
+        unschedule(index);
+
+    // backward-shift deletion: move later entries of the probe sequence into the hole
+    unsigned int hole = entry.slot;
+    unsigned int j = hole;
+    for (;;)
+    {
+        j = (j + 1) & slotMask;
+        if (slots[j] < 0)
+            break;
+        unsigned int k = home(entries[slots[j]].key);
+        bool movable = (j > hole) ? (k <= hole || k > j) : (k <= hole && k > j);
+        if (movable)
+        {
+            slots[hole] = slots[j];
+            entries[slots[hole]].slot = hole;
+            hole = j;
+        }
+    }
+    slots[hole] = -1;
+
+    entry.key = NO_KEY;
+    entry.slot = -1;
+    entry.next = freeList;
+    freeList = index;
+    numEntries--;
+}
+
+int FlatMACAddressTable::learn(uint64 key, int portno)
+{
+    advance();
+
+    int index = findEntry(key);
+    if (index < 0)
+    {
+        numLearned++;
+        insert(key, portno, false);
+        return -1;
+    }
+
+    // refresh: the entry is moved in the wheel only when its bucket expires
+    Entry& entry = entries[index];
+    if (!entry.isStatic)
+    {
+        entry.insertionTime = simTime();
+        entry.portno = portno;
+    }
+    return index;
+}
+
+void FlatMACAddressTable::schedule(int index)
+{
+    Entry& entry = entries[index];
+    int64 delta = entry.expiryTick - currentTick;
+    if (delta <= 0)
+        entry.bucket = (currentTick + 1) & (WHEEL0_SIZE - 1);
+    else if (delta < WHEEL0_SIZE)
+        entry.bucket = entry.expiryTick & (WHEEL0_SIZE - 1);
+    else if (delta < (int64)WHEEL0_SIZE * (WHEEL1_SIZE - 1))
+        entry.bucket = WHEEL0_SIZE + ((entry.expiryTick / WHEEL0_SIZE) & (WHEEL1_SIZE - 1));
+    else    // beyond the wheel: parked in the last level-1 bucket and rescheduled from there
+        entry.bucket = WHEEL0_SIZE + ((currentTick / WHEEL0_SIZE + WHEEL1_SIZE - 1) & (WHEEL1_SIZE - 1));
+
+    int& head = buckets[entry.bucket];
+    entry.prev = -1;
+    entry.next = head;
+    if (head >= 0)
+        entries[head].prev = index;
+    head = index;
+}
+
+void FlatMACAddressTable::unschedule(int index)
+{
+    Entry& entry = entries[index];
+    if (entry.prev >= 0)
+        entries[entry.prev].next = entry.next;
+    else
+        buckets[entry.bucket] = entry.next;
+    if (entry.next >= 0)
+        entries[entry.next].prev = entry.prev;
+    entry.prev = entry.next = -1;
+    entry.bucket = -1;
+}
+
+void FlatMACAddressTable::expireBucket(int bucket)
+{
+    int index = buckets[bucket];
+    buckets[bucket] = -1;
+    simtime_t now = simTime();
+    while (index >= 0)
+    {
+        Entry& entry = entries[index];
+        int next = entry.next;
+        entry.prev = entry.next = -1;
+        entry.bucket = -1;
+        if (entry.insertionTime + agingTime <= now)
+        {
+            remove(index);
+            numAged++;
+        }
+        else
+        {
+            // refreshed since it was scheduled
+            entry.expiryTick = tickOf(entry.insertionTime + agingTime);
+            schedule(index);
+        }
+        index = next;
+    }
+}
+
+void FlatMACAddressTable::advance()
+{
+    int64 nowTick = (int64)floor(simTime() / tickLength);
+    if (nowTick <= currentTick)
+        return;
+
+    if (nowTick - currentTick > (int64)WHEEL0_SIZE * WHEEL1_SIZE)
+    {
+        // the whole wheel has elapsed since the last call
+        currentTick = nowTick;
+        rescheduleAll();
+        return;
+    }
+
+    while (currentTick < nowTick)
+    {
+        currentTick++;
+        if ((currentTick & (WHEEL0_SIZE - 1)) == 0)
+            expireBucket(WHEEL0_SIZE + ((currentTick / WHEEL0_SIZE) & (WHEEL1_SIZE - 1)));
+        expireBucket(currentTick & (WHEEL0_SIZE - 1));
+    }
+}
+
+void FlatMACAddressTable::rescheduleAll()
+{
+    for (int i = 0; i < WHEEL0_SIZE + WHEEL1_SIZE; i++)
+        buckets[i] = -1;
+
+    simtime_t now = simTime();
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+        Entry& entry = entries[i];
+        if (entry.key == NO_KEY || entry.isStatic)
+            continue;
+        entry.prev = entry.next = -1;
+        entry.bucket = -1;
+        if (entry.insertionTime + agingTime <= now)
+        {
+            remove(i);
+            numAged++;
+        }
+        else
+        {
+            entry.expiryTick = tickOf(entry.insertionTime + agingTime);
+            schedule(i);
+        }
+    }
+}
+
+int FlatMACAddressTable::getPortForAddress(MACAddress& address, unsigned int vid)
+{
+    Enter_Method("FlatMACAddressTable::getPortForAddress()");
+
+    int index = findEntry(makeKey(address, vid));
+    if (index < 0)
+    {
+        EV << "Address " << address << " not found in Address Table" << endl;
+        return -1;
+    }
+
+    Entry& entry = entries[index];
+    if (!entry.isStatic && entry.insertionTime + agingTime <= simTime())
+    {
+        EV << "Ignoring and deleting aged entry: " << address << " --> port" << entry.portno << endl;
+        remove(index);
+        numAged++;
+        return -1;
+    }
+    return entry.portno;
+}
+
+bool FlatMACAddressTable::updateTableWithAddress(int portno, MACAddress& address, unsigned int vid)
+{
+    Enter_Method("FlatMACAddressTable::updateTableWithAddress()");
+
+    if (address.isBroadcast())
+        return false;
+
+    if (learn(makeKey(address, vid), portno) < 0)
+    {
+        EV << "Adding entry to Address Table: " << address << " --> port" << portno << endl;
+        return false;
+    }
+    EV << "Updating entry in Address Table: " << address << " --> port" << portno << endl;
+    return true;
+}
+
+void FlatMACAddressTable::flush(int portno)
+{
+    Enter_Method("FlatMACAddressTable::flush()");
+
+    for (int i = 0; i < (int)entries.size(); i++)
+        if (entries[i].key != NO_KEY && !entries[i].isStatic && entries[i].portno == portno)
+            remove(i);
+}
+
+void FlatMACAddressTable::printState()
+{
+    EV << endl << "MAC Address Table" << endl;
+    EV << "VLAN ID    MAC    Port    Inserted" << endl;
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+        const Entry& entry = entries[i];
+        if (entry.key == NO_KEY)
+            continue;
+        EV << (entry.key >> 48) << "   " << MACAddress(entry.key & 0xFFFFFFFFFFFFULL) << "   " << entry.portno << "   ";
+        if (entry.isStatic)
+            EV << "static" << endl;
+        else
+            EV << entry.insertionTime << endl;
+    }
+}
+
+void FlatMACAddressTable::copyTable(int portA, int portB)
+{
+    for (int i = 0; i < (int)entries.size(); i++)
+        if (entries[i].key != NO_KEY && !entries[i].isStatic && entries[i].portno == portA)
+            entries[i].portno = portB;
+}
+
+void FlatMACAddressTable::removeAgedEntriesFromVlan(unsigned int vid)
+{
+    simtime_t now = simTime();
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+        const Entry& entry = entries[i];
+        if (entry.key != NO_KEY && !entry.isStatic && (entry.key >> 48) == vid && entry.insertionTime + agingTime <= now)
+        {
+            EV << "Removing aged entry from Address Table: " << MACAddress(entry.key & 0xFFFFFFFFFFFFULL)
+               << " --> port" << entry.portno << endl;
+            remove(i);
+            numAged++;
+        }
+    }
+}
+
+void FlatMACAddressTable::removeAgedEntriesFromAllVlans()
+{
+    advance();
+    rescheduleAll();
+}
+
+void FlatMACAddressTable::removeAgedEntriesIfNeeded()
+{
+    advance();
+}
+
+void FlatMACAddressTable::clearTable()
+{
+    for (int i = 0; i < (int)entries.size(); i++)
+        if (entries[i].key != NO_KEY && !entries[i].isStatic)
+            remove(i);
+}
+
+void FlatMACAddressTable::setAgingTime(simtime_t agingTime)
+{
+    this->agingTime = agingTime;
+    rescheduleAll();
+}
+
+void FlatMACAddressTable::resetDefaultAging()
+{
+    setAgingTime(defaultAgingTime);
+}
+
+void FlatMACAddressTable::finish()
+{
+    recordScalar("learned addresses", numLearned);
+    recordScalar("aged addresses", numAged);
+    recordScalar("table grows", numGrows);
+}
@@ -0,0 +1,151 @@
+#ifndef __INET_FLATMACADDRESSTABLE_H
+#define __INET_FLATMACADDRESSTABLE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+#include "IMACAddressTable.h"
+
+/**
+ * MAC address table with the semantics of MACAddressTable, stored as a flat
+ * open-addressing hash (linear probing, backward-shift deletion) keyed by
+ * the 48-bit MAC address and the VLAN id packed into one 64-bit integer.
+ * Entries live in a preallocated pool, so learning and lookup do not
+ * allocate unless the table has to grow.
+ *
+ * Aging runs on a two-level timing wheel with a resolution of agingTime/64:
+ * refreshing an entry only updates its insertion time, and the entry is
+ * moved to a later bucket when its bucket expires. Lookups still check the
+ * exact insertion time, so an aged entry is never returned.
+ *
+ * Static entries (e.g. the destination addresses of VLs) are read from the
+ * staticEntries parameter; they never age and survive flush() and
+ * clearTable().
+ *
+ * <pre>
+ * <entries>
+ *     <entry address="03-00-00-00-00-D6" port="2" vid="0"/>
+ * </entries>
+ * </pre>
+ *
+ * The relay uses learnAddress() and lookupAddress() directly through a typed
+ * pointer; they do the same as updateTableWithAddress() and
+ * getPortForAddress() for VLAN 0 without the Enter_Method overhead.
+ */
+class INET_API FlatMACAddressTable : public cSimpleModule, public IMACAddressTable
+{
+  protected:
+    struct Entry
+    {
+        uint64 key;                 // vid << 48 | address, or NO_KEY in the free list
+        int portno;
+        bool isStatic;
+        simtime_t insertionTime;
+        int64 expiryTick;           // wheel tick at which the entry is checked
+        int slot;                   // position in the hash array
+        int bucket;                 // wheel bucket, or -1 if not scheduled
+        int prev, next;             // links of the wheel bucket (next also links the free list)
+    };
+
+    enum { WHEEL0_SIZE = 256, WHEEL1_SIZE = 64, TICKS_PER_AGING_TIME = 64 };
+    static const uint64 NO_KEY = ~(uint64)0;
+
+    std::vector<Entry> entries;     // entry pool
+    std::vector<int> slots;         // hash array: index into entries, or -1
+    unsigned int slotMask;
+    int hashShift;
+    int freeList;
+    int numEntries;
+
+    // timing wheel: buckets 0..WHEEL0_SIZE-1 (level 0) cover one tick each,
+    // the following WHEEL1_SIZE buckets (level 1) WHEEL0_SIZE ticks each
+    int buckets[WHEEL0_SIZE + WHEEL1_SIZE];
+    int64 currentTick;
+    simtime_t tickLength;
+
+    simtime_t agingTime;
+    simtime_t defaultAgingTime;
+
+    // statistics
+    long numLearned;
+    long numAged;
+    long numGrows;
+
+  protected:
+    virtual void initialize();
+    virtual void handleMessage(cMessage *msg);
+    virtual void finish();
+
+    static uint64 makeKey(const MACAddress& address, unsigned int vid) { return ((uint64)vid << 48) | address.getInt(); }
+    unsigned int home(uint64 key) const { return (unsigned int)((key * 0x9E3779B97F4A7C15ULL) >> hashShift); }
+
+    int findEntry(uint64 key) const
+    {
+        for (unsigned int i = home(key); slots[i] >= 0; i = (i + 1) & slotMask)
+            if (entries[slots[i]].key == key)
+                return slots[i];
+        return -1;
+    }
+
+    virtual void resize(unsigned int numSlots);
+    virtual int insert(uint64 key, int portno, bool isStatic);
+    virtual void remove(int index);
+    virtual int learn(uint64 key, int portno);
+
+    virtual void loadStaticEntries(cXMLElement *config);
+
+    // timing wheel
+    int64 tickOf(simtime_t t) const { return (int64)ceil(t / tickLength); }
+    virtual void schedule(int index);
+    virtual void unschedule(int index);
+    virtual void advance();
+    virtual void expireBucket(int bucket);
+    virtual void rescheduleAll();
+
+  public:
+    FlatMACAddressTable();
+
+    /**
+     * Fast path for the relay: updateTableWithAddress() for VLAN 0.
+     */
+    void learnAddress(int portno, const MACAddress& address)
+    {
+        if (!address.isBroadcast())
+            learn(makeKey(address, 0), portno);
+    }
+
+    /**
+     * Fast path for the relay: getPortForAddress() for VLAN 0.
+     */
+    int lookupAddress(const MACAddress& address)
+    {
+        int index = findEntry(makeKey(address, 0));
+        if (index < 0)
+            return -1;
+        Entry& entry = entries[index];
+        if (!entry.isStatic && entry.insertionTime + agingTime <= simTime())
+        {
+            remove(index);
+            numAged++;
+            return -1;
+        }
+        return entry.portno;
+    }
+
+    // IMACAddressTable
+    virtual int getPortForAddress(MACAddress& address, unsigned int vid = 0);
+    virtual bool updateTableWithAddress(int portno, MACAddress& address, unsigned int vid = 0);
+    virtual void flush(int portno);
+    virtual void printState();
+    virtual void copyTable(int portA, int portB);
+    virtual void removeAgedEntriesFromVlan(unsigned int vid = 0);
+    virtual void removeAgedEntriesFromAllVlans();
+    virtual void removeAgedEntriesIfNeeded();
+    virtual void clearTable();
+    virtual void setAgingTime(simtime_t agingTime);
+    virtual void resetDefaultAging();
+};
+
+#endif
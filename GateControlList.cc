@@ -0,0 +1,151 @@
+#include <string.h>
+
+#include "GateControlList.h"
+
+GateControlList::GateControlList()
+{
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+        maxOpenTime[tc] = MAXTIME;
+}
+
+static simtime_t timeAttribute(cXMLElement *element, const char *name, simtime_t defaultValue)
+{
+    const char *value = element->getAttribute(name);
+    if (!value)
+        return defaultValue;
+    try
+    {
+        return SimTime::parse(value);
+    }
+    catch (std::exception& e)
+    {
+        throw cRuntimeError("Invalid time '%s' in attribute '%s' at %s", value, name, element->getSourceLocation());
+    }
+}
+
+void GateControlList::load(cXMLElement *gcl)
+{
+    entries.clear();
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+        maxOpenTime[tc] = MAXTIME;
+
+    if (!gcl)
+        return;
+
+    simtime_t offset = SIMTIME_ZERO;
+    cXMLElementList list = gcl->getChildrenByTagName("entry");
+    for (cXMLElementList::iterator it = list.begin(); it != list.end(); it++)
+    {
+        Entry entry;
+        entry.offset = offset;
+        entry.duration = timeAttribute(*it, "duration", SIMTIME_ZERO);
+        if (entry.duration <= SIMTIME_ZERO)
+            throw cRuntimeError("GCL entry needs a positive duration at %s", (*it)->getSourceLocation());
+
+        const char *gates = (*it)->getAttribute("gates");
+        if (!gates || strlen(gates) != NUM_TRAFFIC_CLASSES || strspn(gates, "01") != NUM_TRAFFIC_CLASSES)
+            throw cRuntimeError("GCL entry needs a gates attribute of %d bits (T%d..T0) at %s",
+                    NUM_TRAFFIC_CLASSES, NUM_TRAFFIC_CLASSES - 1, (*it)->getSourceLocation());
+        entry.gates = 0;
+        for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++)
+            if (gates[i] == '1')
+                entry.gates |= 1 << (NUM_TRAFFIC_CLASSES - 1 - i);
+
+        entries.push_back(entry);
+        offset += entry.duration;
+    }
+
+    if (entries.empty())
+        return;
+
+    cycleTime = timeAttribute(gcl, "cycleTime", offset);
+    baseTime = timeAttribute(gcl, "baseTime", SIMTIME_ZERO);
+    if (offset > cycleTime)
+        throw cRuntimeError("GCL entries (%s) exceed the cycle time (%s) at %s",
+                offset.str().c_str(), cycleTime.str().c_str(), gcl->getSourceLocation());
+    entries.back().duration += cycleTime - offset;
+
+    // gate close offsets: walk forward from each entry, wrapping around the cycle
+    int n = entries.size();
+    for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++)
+    {
+        unsigned char bit = 1 << tc;
+        simtime_t longest = SIMTIME_ZERO;
+        bool alwaysOpen = true;
+        for (int i = 0; i < n; i++)
+        {
+            Entry& entry = entries[i];
+            if (!(entry.gates & bit))
+            {
+                alwaysOpen = false;
+                entry.closeAfter[tc] = SIMTIME_ZERO;
+                continue;
+            }
+            simtime_t open = SIMTIME_ZERO;
+            int j = i;
+            int steps = 0;
+            while ((entries[j].gates & bit) && steps < n)
+            {
+                open += entries[j].duration;
+                j = (j + 1) % n;
+                steps++;
+            }
+            entry.closeAfter[tc] = steps == n ? -1 : open;
+            if (open > longest)
+                longest = open;
+        }
+        maxOpenTime[tc] = alwaysOpen ? MAXTIME : longest;
+    }
+}
+
+const GateControlList::Entry& GateControlList::findEntry(simtime_t t, simtime_t& cycleStart) const
+{
+    int64 phase = (t - baseTime).raw() % cycleTime.raw();
+    if (phase < 0)
+        phase += cycleTime.raw();
+    simtime_t inCycle;
+    inCycle.setRaw(phase);
+    cycleStart = t - inCycle;
+
+    // last entry with offset <= inCycle
+    int lo = 0, hi = entries.size() - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (entries[mid].offset <= inCycle)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return entries[lo];
+}
+
+bool GateControlList::isOpen(int trafficClass, simtime_t t) const
+{
+    if (entries.empty())
+        return true;
+    simtime_t cycleStart;
+    return (findEntry(t, cycleStart).gates & (1 << trafficClass)) != 0;
+}
+
+simtime_t GateControlList::getCloseTime(int trafficClass, simtime_t t) const
+{
+    if (entries.empty())
+        return MAXTIME;
+    simtime_t cycleStart;
+    const Entry& entry = findEntry(t, cycleStart);
+    if (!(entry.gates & (1 << trafficClass)))
+        return t;
+    if (entry.closeAfter[trafficClass] < SIMTIME_ZERO)
+        return MAXTIME;
+    return cycleStart + entry.offset + entry.closeAfter[trafficClass];
+}
+
+simtime_t GateControlList::getNextChange(simtime_t t) const
+{
+    if (entries.empty())
+        return MAXTIME;
+    simtime_t cycleStart;
+    const Entry& entry = findEntry(t, cycleStart);
+    return cycleStart + entry.offset + entry.duration;
+}
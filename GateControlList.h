@@ -0,0 +1,84 @@
+#ifndef __INET_GATECONTROLLIST_H
+#define __INET_GATECONTROLLIST_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+// number of traffic classes (and transmission gates) of a port
+#define NUM_TRAFFIC_CLASSES     8
+
+/**
+ * Cyclic gate control list of an IEEE 802.1Qbv time-aware shaper.
+ *
+ * The list is read from XML; each entry opens the gates whose bit is set in
+ * the "gates" attribute (written T7..T0, i.e. the first character is traffic
+ * class 7) for the given duration. The schedule repeats every cycleTime
+ * (default: the sum of the durations; if the entries are shorter than the
+ * cycle, the last one extends to the end of it), with cycles aligned to
+ * baseTime.
+ *
+ * <pre>
+ * <gcl cycleTime="1ms" baseTime="0s">
+ *     <entry duration="100us" gates="10000000"/>
+ *     <entry duration="900us" gates="01111111"/>
+ * </gcl>
+ * </pre>
+ *
+ * For every entry and traffic class the offset at which the gate closes is
+ * precomputed at load time, so getCloseTime() and getNextChange() only
+ * locate the current entry (binary search) and add offsets.
+ */
+class INET_API GateControlList
+{
+  protected:
+    struct Entry
+    {
+        simtime_t offset;           // start within the cycle
+        simtime_t duration;
+        unsigned char gates;        // bit i: gate of traffic class i open
+
+        // time from the start of the entry until the gate closes, or -1 if it never closes
+        simtime_t closeAfter[NUM_TRAFFIC_CLASSES];
+    };
+
+    std::vector<Entry> entries;
+    simtime_t cycleTime;
+    simtime_t baseTime;
+    simtime_t maxOpenTime[NUM_TRAFFIC_CLASSES];    // longest continuous open interval
+
+  protected:
+    const Entry& findEntry(simtime_t t, simtime_t& cycleStart) const;
+
+  public:
+    GateControlList();
+
+    /**
+     * Loads the list; an empty <gcl/> element (or NULL) leaves all gates
+     * permanently open.
+     */
+    void load(cXMLElement *gcl);
+
+    bool isEmpty() const { return entries.empty(); }
+
+    bool isOpen(int trafficClass, simtime_t t) const;
+
+    /**
+     * Time at which the gate of trafficClass, open at t, closes; MAXTIME if
+     * it stays open. Returns t if the gate is closed at t.
+     */
+    simtime_t getCloseTime(int trafficClass, simtime_t t) const;
+
+    /**
+     * Time of the first gate transition after t.
+     */
+    simtime_t getNextChange(simtime_t t) const;
+
+    /**
+     * Longest interval the gate of trafficClass stays open; MAXTIME if it
+     * is always open. A frame longer than this can never be sent.
+     */
+    simtime_t getMaxOpenTime(int trafficClass) const { return maxOpenTime[trafficClass]; }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include <stdio.h>
+
+#include "HandlerProfiler.h"
+
+void HandlerProfiler::enable(const char **names, int numHandlers)
+{
+    handlers.clear();
+    handlers.resize(numHandlers);
+    for (int i = 0; i < numHandlers; i++)
+        handlers[i].name = names[i];
+    startTicks = now();
+    startWallClock = wallClockNow();
+    enabled = true;
+}
+
+void HandlerProfiler::recordScalars(cComponent *component) const
+{
+    if (!enabled)
+        return;
+
+    // ticks per second over the profiled period
+    double secondsPerTick = 1e-9;
+#ifdef HANDLER_PROFILER_TSC
+    double elapsed = wallClockNow() - startWallClock;
+    int64 elapsedTicks = now() - startTicks;
+    secondsPerTick = (elapsed > 0 && elapsedTicks > 0) ? elapsed / elapsedTicks : 0;
+#endif
+
+    char name[128];
+    for (unsigned int i = 0; i < handlers.size(); i++)
+    {
+        const Handler& h = handlers[i];
+        if (h.total.calls == 0)
+            continue;
+        snprintf(name, sizeof(name), "handler %s calls", h.name.c_str());
+        component->recordScalar(name, h.total.calls);
+        snprintf(name, sizeof(name), "handler %s time", h.name.c_str());
+        component->recordScalar(name, h.total.ticks * secondsPerTick, "s");
+
+        for (int k = 0; k <= MAX_KINDS; k++)
+        {
+            const Counter& c = h.kinds[k];
+            if (c.calls == 0 || c.calls == h.total.calls)
+                continue;   // a single kind is already covered by the totals
+            if (k < MAX_KINDS)
+                snprintf(name, sizeof(name), "handler %s kind %d", h.name.c_str(), k);
+            else
+                snprintf(name, sizeof(name), "handler %s kind other", h.name.c_str());
+            std::string prefix = name;
+            component->recordScalar((prefix + " calls").c_str(), c.calls);
+            component->recordScalar((prefix + " time").c_str(), c.ticks * secondsPerTick, "s");
+        }
+    }
+}
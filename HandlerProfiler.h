@@ -0,0 +1,148 @@
+#ifndef __INET_HANDLERPROFILER_H
+#define __INET_HANDLERPROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "WallClock.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HANDLER_PROFILER_TSC 1
+#endif
+
+//
+// HANDLER_PROFILING selects at build time whether the PROFILE_HANDLER()
+// scopes are compiled in (default 1). At run time a profiler only measures
+// after enable() (the profileHandlers parameter of the module); when it is
+// disabled a scope costs one branch.
+//
+#ifndef HANDLER_PROFILING
+#define HANDLER_PROFILING 1
+#endif
+
+/**
+ * Call counts and real time spent per message handler of a module, split by
+ * message kind (kinds 0..MAX_KINDS-1 separately, the rest together). Time is
+ * measured with the TSC where available (converted to seconds against the
+ * monotonic wall clock over the profiled period), otherwise with the
+ * monotonic clock itself.
+ *
+ * <pre>
+ * static const char *handlerNames[] = { "handleSelfMessage", "processMsgFromNetwork" };
+ * ...
+ * if (par("profileHandlers"))
+ *     profiler.enable(handlerNames, 2);
+ * ...
+ * {
+ *     PROFILE_HANDLER(profiler, 1, msg->getKind());
+ *     processMsgFromNetwork(msg);
+ * }
+ * ...
+ * profiler.recordScalars(this);     // in finish()
+ * </pre>
+ */
+class INET_API HandlerProfiler
+{
+  public:
+    enum { MAX_KINDS = 32 };
+
+    /**
+     * Measures the enclosing block for one handler of the profiler.
+     */
+    class Scope
+    {
+      protected:
+        HandlerProfiler *profiler;
+        int handler;
+        int kind;
+        int64 start;
+
+      public:
+        Scope(HandlerProfiler& profiler, int handler, int kind)
+        {
+            if (profiler.isEnabled())
+            {
+                this->profiler = &profiler;
+                this->handler = handler;
+                this->kind = kind;
+                start = now();
+            }
+            else
+                this->profiler = NULL;
+        }
+
+        ~Scope()
+        {
+            if (profiler)
+                profiler->add(handler, kind, now() - start);
+        }
+    };
+
+  protected:
+    struct Counter
+    {
+        long calls;
+        int64 ticks;
+        Counter() : calls(0), ticks(0) {}
+    };
+
+    struct Handler
+    {
+        std::string name;
+        Counter total;
+        Counter kinds[MAX_KINDS + 1];   // the last one counts the other kinds
+    };
+
+    bool enabled;
+    std::vector<Handler> handlers;
+    int64 startTicks;
+    double startWallClock;
+
+  public:
+    HandlerProfiler() : enabled(false), startTicks(0), startWallClock(0) {}
+
+    static int64 now()
+    {
+#ifdef HANDLER_PROFILER_TSC
+        return (int64)__rdtsc();
+#else
+        return (int64)(wallClockNow() * 1e9);
+#endif
+    }
+
+    /**
+     * Starts profiling the given handlers; PROFILE_HANDLER() refers to them
+     * by their index in names.
+     */
+    void enable(const char **names, int numHandlers);
+
+    bool isEnabled() const { return enabled; }
+
+    void add(int handler, int kind, int64 ticks)
+    {
+        Handler& h = handlers[handler];
+        Counter& k = h.kinds[kind >= 0 && kind < MAX_KINDS ? kind : MAX_KINDS];
+        h.total.calls++;
+        h.total.ticks += ticks;
+        k.calls++;
+        k.ticks += ticks;
+    }
+
+    /**
+     * Records "handler <name> calls", "handler <name> time" and the same per
+     * message kind ("handler <name> kind <k> ...") for the handlers that
+     * were called.
+     */
+    void recordScalars(cComponent *component) const;
+};
+
+#if HANDLER_PROFILING
+#define PROFILE_HANDLER(profiler, handler, kind)    HandlerProfiler::Scope handlerProfilerScope_((profiler), (handler), (kind))
+#else
+#define PROFILE_HANDLER(profiler, handler, kind)
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __INET_HOTPATHLOG_H
+#define __INET_HOTPATHLOG_H
+
+#include "INETDefs.h"
+
+//
+// Per-frame log statements of the relay and MAC hot paths.
+//
+// HOTPATH_LOGLEVEL selects at build time which of them are compiled in:
+// 0 = none, 1 = EV_HOT_INFO only, 2 = EV_HOT_INFO and EV_HOT_DETAIL (default).
+// At run time they are additionally gated by the hotPathLogging member of the
+// module (the hotPathLogging parameter). In both cases the condition is tested
+// before the stream operands are evaluated, so a disabled statement does not
+// format the frame or its addresses.
+//
+#ifndef HOTPATH_LOGLEVEL
+#define HOTPATH_LOGLEVEL 2
+#endif
+
+#define HOTPATH_LOG_IF(level)   if (HOTPATH_LOGLEVEL < (level) || !hotPathLogging) ; else
+
+#define EV_HOT          HOTPATH_LOG_IF(1) EV
+#define EV_HOT_INFO     HOTPATH_LOG_IF(1) EV_INFO
+#define EV_HOT_DETAIL   HOTPATH_LOG_IF(2) EV_DETAIL
+
+#endif
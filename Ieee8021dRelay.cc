@@ -9,6 +9,8 @@
 #include "InterfaceEntry.h"
 #include "Ieee8021dInterfaceData.h"
 #include "ModuleAccess.h"
+#include "NotifierConsts.h"
+#include "HotPathLog.h"
 
 
 Define_Module(Ieee8021dRelay);
@@ -17,9 +19,15 @@ Ieee8021dRelay::Ieee8021dRelay()
 {
     ifTable = NULL;
     macTable = NULL;
+    flatMacTable = NULL;
     ie = NULL;
+    scheduleStore = NULL;
+    nb = NULL;
+    hotPathLogging = true;
 }
 
+static const char *profiledHandlerNames[] = { "dispatchBPDU", "handleConfiguration", "handleAndDispatchFrame" };
+
 void Ieee8021dRelay::initialize(int stage)
 {
 
@@ -34,6 +42,11 @@ void Ieee8021dRelay::initialize(int stage)
         portCount = gate("ifOut", 0)->size();
         if (gate("ifIn", 0)->size() != (int)portCount)
             error("the sizes of the ifIn[] and ifOut[] gate vectors must be the same");
+        floodPorts.reserve(portCount);
+
+        hotPathLogging = par("hotPathLogging").boolValue();
+        if (par("profileHandlers").boolValue())
+            profiler.enable(profiledHandlerNames, NUM_PROFILED_HANDLERS);
     }
     else if (stage == 1)
     {
@@ -41,7 +54,9 @@ void Ieee8021dRelay::initialize(int stage)
         isOperational = (!nodeStatus) || nodeStatus->getState() == NodeStatus::UP;
 
         macTable = check_and_cast<IMACAddressTable *>(getModuleByPath(par("macTablePath")));
+        flatMacTable = dynamic_cast<FlatMACAddressTable *>(macTable);
         ifTable = check_and_cast<IInterfaceTable*>(getModuleByPath(par("interfaceTablePath")));
+        scheduleStore = ScheduleStore::findFor(getParentModule());
 
         if (isOperational)
         {
@@ -55,6 +70,12 @@ void Ieee8021dRelay::initialize(int stage)
 
         isStpAware = gate("stpIn")->isConnected(); // if the stpIn is not connected then the switch is STP/RSTP unaware
 
+        // port roles/states are refreshed through the notification board
+        nb = NotificationBoardAccess().get();
+        nb->subscribe(this, NF_INTERFACE_STATE_CHANGED);
+        nb->subscribe(this, NF_INTERFACE_CONFIG_CHANGED);
+        refreshPortCache();
+
         WATCH(bridgeAddress);
         WATCH(numReceivedNetworkFrames);
         WATCH(numDroppedFrames);
@@ -80,58 +101,35 @@ void Ieee8021dRelay::handleMessage(cMessage * msg)
         {
             numReceivedBPDUsFromSTP++;
             EV_INFO << "Received " << msg << " from STP/RSTP module." << endl;
+            PROFILE_HANDLER(profiler, PROFILE_BPDU_FROM_STP, msg->getKind());
             BPDU * bpdu = check_and_cast<BPDU* >(msg);
             dispatchBPDU(bpdu);
         }
         // messages from network
         else if (strcmp(msg->getArrivalGate()->getName(), "ifIn") == 0)
         {
+            EtherFrame * frame = check_and_cast<EtherFrame*>(msg);
 
-            // La modificación consiste en el procesamiento del mensaje de configuración
+            // La modificación consiste en el procesamiento del paquete de configuración
             // proveniente del módulo de gestión. En base a esto se establecen los tiempos
-            // correspondientes a las ventanas
-
-
-            if (strncmp(msg->getName(),"configuracion",13) == 0){
-
-                int tiempo=0;
-                char name[40];
-                char nombremoduloin[11];
-                char nombremoduloout[10];
-                std::string gates;
-                char ruta[40];
-
-                sscanf(msg->getName(), "%s %s %d", name, nombremoduloout, &tiempo);
-
-                cModule *parentModule = getParentModule();
-
-                sprintf(nombremoduloin, "%s_ctc",nombremoduloout);
-
-                // ventanas de entrada
-                cModule *moduloin = parentModule->getSubmodule(nombremoduloin);
-
-                moduloin->par("receive_window_start").setLongValue(tiempo+11);
-                moduloin->par("receive_window_end").setLongValue(tiempo+21);
-                moduloin->par("permanence_pit").setLongValue(tiempo+21);
-
-                // ventanas de salida
-                cModule *moduloout = parentModule->getSubmodule(nombremoduloout);
-
-                moduloout->par("sendWindowStart").setLongValue(tiempo+22);
-                moduloout->par("sendWindowEnd").setLongValue(tiempo+23);
+            // correspondientes a las ventanas. Las configuraciones se reconocen por el
+            // EtherType de la trama, sin acceder al contenido de las demás tramas
 
+            EthernetIIFrame * ethIIFrame = dynamic_cast<EthernetIIFrame *>(frame);
+            if (ethIIFrame && ethIIFrame->getEtherType() == ETHERTYPE_VL_CONFIG)
+            {
                 EV_INFO << "Received " << msg << " from controlador. "  <<endl;
-                bubble("ARRIVED, recibida nueva configuración!");
-
-
-
+                PROFILE_HANDLER(profiler, PROFILE_CONFIGURATION, msg->getKind());
+                VLConfigPacket * config = check_and_cast<VLConfigPacket *>(frame->decapsulate());
+                handleConfiguration(config);
+                delete config;
+                delete frame;
                 return;
-
             }
 
             numReceivedNetworkFrames++;
-            EV_INFO << "Received " << msg << " from network." << endl;
-            EtherFrame * frame = check_and_cast<EtherFrame*>(msg);
+            EV_HOT_INFO << "Received " << msg << " from network." << endl;
+            PROFILE_HANDLER(profiler, PROFILE_FRAME, msg->getKind());
             handleAndDispatchFrame(frame);
         }
 
@@ -140,17 +138,62 @@ void Ieee8021dRelay::handleMessage(cMessage * msg)
         throw cRuntimeError("This module doesn't handle self-messages!");
 }
 
+void Ieee8021dRelay::handleConfiguration(VLConfigPacket * config)
+{
+    int vlId = config->getVlId();
+
+    if (!scheduleStore)
+        throw cRuntimeError("Configuration received but switch has no scheduleStore module");
+
+    // con un schedule sintetizado las ventanas no se reconfiguran
+    if (scheduleStore->isStatic())
+    {
+        EV_DETAIL << "Static schedule in use, configuration for VL " << vlId << " ignored" << endl;
+        return;
+    }
+
+    // se descartan configuraciones anteriores a la ya aplicada del mismo switch de origen
+    std::pair<int, int> key(config->getOrigin(), vlId);
+    std::map<std::pair<int, int>, int>::iterator it = configVersion.find(key);
+    if (it != configVersion.end() && config->getVersion() <= it->second)
+    {
+        EV_DETAIL << "Stale configuration version " << config->getVersion() << " for VL " << vlId
+                  << " from " << config->getOrigin() << ", ignored" << endl;
+        return;
+    }
+    configVersion[key] = config->getVersion();
+
+    int tiempo = config->getWindowTime() + config->getHopOffset();
+
+    // ventanas de entrada y de salida
+    scheduleStore->setWindows(vlId, tiempo+11, tiempo+21, tiempo+21, tiempo+22, tiempo+23);
+
+    bubble("ARRIVED, recibida nueva configuración!");
+}
+
 void Ieee8021dRelay::broadcast(EtherFrame * frame)
 {
-    EV_DETAIL << "Broadcast frame " << frame << endl;
+    EV_HOT_DETAIL << "Broadcast frame " << frame << endl;
 
     unsigned int arrivalGate = frame->getArrivalGate()->getIndex();
 
+    // collect the egress ports first, so that the original frame can be sent
+    // on the last one; the copies share the encapsulated payload (cPacket
+    // reference counting), dup() only copies the Ethernet header
+    floodPorts.clear();
     for (unsigned int i = 0; i < portCount; i++)
         if (i != arrivalGate && (!isStpAware || getPortInterfaceData(i)->isForwarding()))
-            dispatch(frame->dup(), i);
+            floodPorts.push_back(i);
+
+    if (floodPorts.empty())
+    {
+        delete frame;
+        return;
+    }
 
-    delete frame;
+    for (unsigned int i = 0; i + 1 < floodPorts.size(); i++)
+        dispatch(frame->dup(), floodPorts[i]);
+    dispatch(frame, floodPorts.back());
 }
 
 void Ieee8021dRelay::handleAndDispatchFrame(EtherFrame * frame)
@@ -177,11 +220,11 @@ void Ieee8021dRelay::handleAndDispatchFrame(EtherFrame * frame)
     }
     else
     {
-        int outGate = macTable->getPortForAddress(frame->getDest());
+        int outGate = flatMacTable ? flatMacTable->lookupAddress(frame->getDest()) : macTable->getPortForAddress(frame->getDest());
         // Not known -> broadcast
         if (outGate == -1)
         {
-            EV_DETAIL << "Destination address = " << frame->getDest() << " unknown, broadcasting frame " << frame << endl;
+            EV_HOT_DETAIL << "Destination address = " << frame->getDest() << " unknown, broadcasting frame " << frame << endl;
             broadcast(frame);
         }
         else
@@ -201,7 +244,7 @@ void Ieee8021dRelay::handleAndDispatchFrame(EtherFrame * frame)
             }
             else
             {
-                EV_DETAIL << "Output port is same as input port, " << frame->getFullName() << " destination = " << frame->getDest() << ", discarding frame " << frame << endl;
+                EV_HOT_DETAIL << "Output port is same as input port, " << frame->getFullName() << " destination = " << frame->getDest() << ", discarding frame " << frame << endl;
                 numDroppedFrames++;
                 delete frame;
             }
@@ -211,12 +254,12 @@ void Ieee8021dRelay::handleAndDispatchFrame(EtherFrame * frame)
 
 void Ieee8021dRelay::dispatch(EtherFrame * frame, unsigned int portNum)
 {
-    EV_INFO << "Sending frame " << frame << " on output port " << portNum << "." << endl;
+    EV_HOT_INFO << "Sending frame " << frame << " on output port " << portNum << "." << endl;
 
     if (portNum >= portCount)
         throw cRuntimeError("Output port %d doesn't exist!",portNum);
 
-    EV_INFO << "Sending " << frame << " with destination = " << frame->getDest() << ", port = " << portNum << endl;
+    EV_HOT_INFO << "Sending " << frame << " with destination = " << frame->getDest() << ", port = " << portNum << endl;
 
     numDispatchedNonBPDUFrames++;
     send(frame, "ifOut", portNum);
@@ -229,7 +272,12 @@ void Ieee8021dRelay::learn(EtherFrame * frame)
     Ieee8021dInterfaceData * port = getPortInterfaceData(arrivalGate);
 
     if (!isStpAware || port->isLearning())
-        macTable->updateTableWithAddress(arrivalGate, frame->getSrc());
+    {
+        if (flatMacTable)
+            flatMacTable->learnAddress(arrivalGate, frame->getSrc());
+        else
+            macTable->updateTableWithAddress(arrivalGate, frame->getSrc());
+    }
 }
 
 void Ieee8021dRelay::dispatchBPDU(BPDU * bpdu)
@@ -278,20 +326,49 @@ void Ieee8021dRelay::deliverBPDU(EtherFrame * frame)
     send(bpdu, "stpOut");
 }
 
-Ieee8021dInterfaceData * Ieee8021dRelay::getPortInterfaceData(unsigned int portNum)
+Ieee8021dInterfaceData * Ieee8021dRelay::lookupPortInterfaceData(unsigned int portNum)
+{
+    if (portNum >= portCount)
+        throw cRuntimeError("Port %d doesn't exist!", portNum);
+
+    cGate * gate = this->getParentModule()->gate("ethg$o", portNum);
+    InterfaceEntry * gateIfEntry = ifTable->getInterfaceByNodeOutputGateId(gate->getId());
+    Ieee8021dInterfaceData * portData = gateIfEntry->ieee8021dData();
+
+    if (!portData)
+        throw cRuntimeError("Ieee8021dInterfaceData not found for port = %d",portNum);
+
+    portDataCache[portNum] = portData;
+    return portData;
+}
+
+void Ieee8021dRelay::refreshPortCache()
 {
-    if (isStpAware)
+    portDataCache.assign(portCount, (Ieee8021dInterfaceData *)NULL);
+
+    if (!isStpAware)
+        return;
+
+    for (unsigned int i = 0; i < portCount; i++)
     {
-        cGate * gate = this->getParentModule()->gate("ethg$o", portNum);
+        cGate * gate = this->getParentModule()->gate("ethg$o", i);
         InterfaceEntry * gateIfEntry = ifTable->getInterfaceByNodeOutputGateId(gate->getId());
-        Ieee8021dInterfaceData * portData = gateIfEntry->ieee8021dData();
+        if (gateIfEntry)
+            portDataCache[i] = gateIfEntry->ieee8021dData();   // may still be NULL before STP initializes
+    }
+}
 
-        if (!portData)
-            throw cRuntimeError("Ieee8021dInterfaceData not found for port = %d",portNum);
+void Ieee8021dRelay::invalidatePortCache()
+{
+    portDataCache.assign(portCount, (Ieee8021dInterfaceData *)NULL);
+}
 
-        return portData;
-    }
-    return NULL;
+void Ieee8021dRelay::receiveChangeNotification(int category, const cObject * details)
+{
+    Enter_Method_Silent();
+
+    if (category == NF_INTERFACE_STATE_CHANGED || category == NF_INTERFACE_CONFIG_CHANGED)
+        invalidatePortCache();
 }
 
 void Ieee8021dRelay::start()
@@ -305,6 +382,7 @@ void Ieee8021dRelay::start()
         throw cRuntimeError("No non-loopback interface found!");
 
     macTable->clearTable();
+    refreshPortCache();
 }
 
 void Ieee8021dRelay::stop()
@@ -340,6 +418,7 @@ void Ieee8021dRelay::finish()
     recordScalar("number of delivered BPDUs to the STP module",numDeliveredBDPUsToSTP);
     recordScalar("number of dispatched BPDU frames to the network",numDispatchedBDPUFrames);
     recordScalar("number of dispatched non-BDPU frames to the network",numDispatchedNonBPDUFrames);
+    profiler.recordScalars(this);
 }
 
 
@@ -0,0 +1,140 @@
+#ifndef __INET_IEEE8021DRELAY_H
+#define __INET_IEEE8021DRELAY_H
+
+#include <map>
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+#include "BPDU_m.h"
+#include "EtherFrame.h"
+#include "IInterfaceTable.h"
+#include "Ieee8021dInterfaceData.h"
+#include "IMACAddressTable.h"
+#include "FlatMACAddressTable.h"
+#include "ILifecycle.h"
+#include "INotifiable.h"
+#include "NotificationBoard.h"
+#include "NodeOperations.h"
+#include "NodeStatus.h"
+#include "VLConfig_m.h"
+#include "ScheduleStore.h"
+#include "HandlerProfiler.h"
+
+//
+// This module forward frames (~EtherFrame) based on their destination MAC addresses to appropriate ports.
+// See the NED definition for details.
+//
+// En los switches de la red del vehículo además procesa los paquetes de
+// configuración (VLConfigPacket) enviados por el módulo de gestión.
+//
+class Ieee8021dRelay : public cSimpleModule, public ILifecycle, public INotifiable
+{
+    public:
+        Ieee8021dRelay();
+
+    protected:
+        MACAddress bridgeAddress;
+        IInterfaceTable * ifTable;
+        IMACAddressTable * macTable;
+        FlatMACAddressTable * flatMacTable; // macTable, if it is a FlatMACAddressTable (direct calls)
+        InterfaceEntry * ie;
+        bool isOperational;
+        bool isStpAware;
+        unsigned int portCount; // number of ports in the switch
+        ScheduleStore * scheduleStore; // ventanas de los VLs del switch
+        NotificationBoard * nb;
+
+        // Ieee8021dInterfaceData of each port, resolved on first use and
+        // invalidated when the interface table reports a change
+        std::vector<Ieee8021dInterfaceData *> portDataCache;
+
+        bool hotPathLogging;    // per-frame log statements enabled (see HotPathLog.h)
+
+        // handlers measured by the profiler (profileHandlers parameter)
+        enum { PROFILE_BPDU_FROM_STP, PROFILE_CONFIGURATION, PROFILE_FRAME, NUM_PROFILED_HANDLERS };
+        HandlerProfiler profiler;
+
+        // egress ports of the frame being flooded (reused, no per-frame allocation)
+        std::vector<unsigned int> floodPorts;
+
+        // última versión de configuración aplicada, por switch de origen y VL:
+        // cada switch numera sus configuraciones de forma independiente
+        std::map<std::pair<int, int>, int> configVersion;
+
+        // statistics: see finish() for details.
+        int numReceivedNetworkFrames;
+        int numDroppedFrames;
+        int numReceivedBPDUsFromSTP;
+        int numDeliveredBDPUsToSTP;
+        int numDispatchedNonBPDUFrames;
+        int numDispatchedBDPUFrames;
+
+    protected:
+        virtual void initialize(int stage);
+        virtual int numInitStages() const { return 2; }
+        virtual void handleMessage(cMessage * msg);
+
+        /**
+         * Updates address table (if the port is in learning state)
+         * with source address, determines output port
+         * and sends out (or broadcasts) frame on ports
+         * (if the ports are in forwarding state).
+         * Includes calls to updateTableWithAddress() and getPortForAddress().
+         *
+         */
+        void handleAndDispatchFrame(EtherFrame * frame);
+        void dispatch(EtherFrame * frame, unsigned int portNum);
+        void learn(EtherFrame * frame);
+        void broadcast(EtherFrame * frame);
+
+        /**
+         * Aplica las ventanas indicadas por un paquete de configuración
+         * recibido del módulo de gestión.
+         */
+        void handleConfiguration(VLConfigPacket * config);
+
+        /**
+         * Receives BPDU from the STP/RSTP module and dispatch it to network.
+         * Sets EherFrame destination, source, etc. according to the BPDU's Ieee802Ctrl info.
+         */
+        void dispatchBPDU(BPDU * bpdu);
+
+        /**
+         * Deliver BPDU to the STP/RSTP module.
+         * Sets the BPDU's Ieee802Ctrl info according to the arriving EtherFrame.
+         */
+        void deliverBPDU(EtherFrame * frame);
+
+        // For lifecycle
+        virtual void start();
+        virtual void stop();
+        bool handleOperationStage(LifecycleOperation * operation, int stage, IDoneCallback * doneCallback);
+
+        /*
+         * Gets port data from the per-port cache, looking it up in the InterfaceTable on a miss
+         */
+        Ieee8021dInterfaceData * getPortInterfaceData(unsigned int portNum)
+        {
+            if (!isStpAware)
+                return NULL;
+            Ieee8021dInterfaceData * portData = portDataCache[portNum];
+            return portData ? portData : lookupPortInterfaceData(portNum);
+        }
+        Ieee8021dInterfaceData * lookupPortInterfaceData(unsigned int portNum);
+
+        /*
+         * Fills the per-port cache (entries whose data is not yet available are resolved lazily)
+         */
+        void refreshPortCache();
+        void invalidatePortCache();
+        virtual void receiveChangeNotification(int category, const cObject * details);
+
+        /*
+         * Returns the first non-loopback interface.
+         */
+        virtual InterfaceEntry * chooseInterface();
+        virtual void finish();
+};
+#endif
@@ -0,0 +1,106 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "LogLinearHistogram.h"
+
+LogLinearHistogram::LogLinearHistogram(int subBucketBits, int valueBits)
+{
+    if (subBucketBits < 1 || subBucketBits > 20 || valueBits <= subBucketBits || valueBits > 62)
+        throw cRuntimeError("LogLinearHistogram: invalid layout (%d sub-bucket bits, %d value bits)", subBucketBits, valueBits);
+    this->subBucketBits = subBucketBits;
+    subBucketCount = (int64)1 << subBucketBits;
+    subBucketHalf = subBucketCount / 2;
+    counts.resize(subBucketCount + (valueBits - subBucketBits) * subBucketHalf);
+    clear();
+}
+
+void LogLinearHistogram::clear()
+{
+    for (unsigned int i = 0; i < counts.size(); i++)
+        counts[i] = 0;
+    numValues = numOverflows = 0;
+    minValue = maxValue = 0;
+    sum = 0;
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram& other)
+{
+    if (other.counts.size() != counts.size() || other.subBucketBits != subBucketBits)
+        throw cRuntimeError("LogLinearHistogram: cannot merge histograms of different layouts");
+    if (other.numValues == 0)
+        return;
+    for (unsigned int i = 0; i < counts.size(); i++)
+        counts[i] += other.counts[i];
+    if (numValues == 0 || other.minValue < minValue)
+        minValue = other.minValue;
+    if (numValues == 0 || other.maxValue > maxValue)
+        maxValue = other.maxValue;
+    numValues += other.numValues;
+    numOverflows += other.numOverflows;
+    sum += other.sum;
+}
+
+int64 LogLinearHistogram::bucketLowValue(int index) const
+{
+    if (index < subBucketCount)
+        return index;
+    int64 k = index - subBucketCount;
+    int shift = (int)(k / subBucketHalf) + 1;
+    return (subBucketHalf + k % subBucketHalf) << shift;
+}
+
+int64 LogLinearHistogram::bucketWidth(int index) const
+{
+    if (index < subBucketCount)
+        return 1;
+    return (int64)1 << ((index - subBucketCount) / subBucketHalf + 1);
+}
+
+int64 LogLinearHistogram::getPercentile(double percentile) const
+{
+    if (numValues == 0)
+        return 0;
+
+    int64 rank = (int64)ceil(percentile / 100.0 * numValues);
+    if (rank < 1)
+        rank = 1;
+    if (rank >= numValues)
+        return maxValue;
+
+    int64 cumulative = 0;
+    for (unsigned int i = 0; i < counts.size(); i++)
+    {
+        cumulative += counts[i];
+        if (cumulative >= rank)
+        {
+            int64 value = bucketLowValue(i) + bucketWidth(i) / 2;
+            if (value < minValue)
+                return minValue;
+            return value > maxValue ? maxValue : value;
+        }
+    }
+    return maxValue;
+}
+
+void LogLinearHistogram::recordAs(cComponent *component, const char *name, double scale, const char *unit) const
+{
+    static const struct { const char *suffix; double percentile; } percentiles[] = {
+        { "p50", 50 }, { "p99", 99 }, { "p99.99", 99.99 }
+    };
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s count", name);
+    component->recordScalar(buf, numValues);
+    if (numValues == 0)
+        return;
+
+    snprintf(buf, sizeof(buf), "%s mean", name);
+    component->recordScalar(buf, getMean() * scale, unit);
+    for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+    {
+        snprintf(buf, sizeof(buf), "%s %s", name, percentiles[i].suffix);
+        component->recordScalar(buf, getPercentile(percentiles[i].percentile) * scale, unit);
+    }
+    snprintf(buf, sizeof(buf), "%s max", name);
+    component->recordScalar(buf, maxValue * scale, unit);
+}
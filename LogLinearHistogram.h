@@ -0,0 +1,106 @@
+#ifndef __INET_LOGLINEARHISTOGRAM_H
+#define __INET_LOGLINEARHISTOGRAM_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+/**
+ * Fixed-memory log-linear histogram of non-negative integer values, in the
+ * style of HdrHistogram. Values below 2^subBucketBits are counted exactly;
+ * above that every power-of-two range is split into 2^(subBucketBits-1)
+ * linear sub-buckets, so the relative error of a reported value is below
+ * 2^-subBucketBits. The bucket array is allocated once in the constructor
+ * and covers values up to 2^valueBits - 1; larger values are counted in the
+ * last bucket (the exact maximum is still kept).
+ *
+ * collect() is a few shifts and an increment, and nothing is stored per
+ * value, so it can stay enabled in long runs. Percentiles are computed by
+ * walking the buckets, which is meant for finish().
+ */
+class INET_API LogLinearHistogram
+{
+  protected:
+    int subBucketBits;
+    int64 subBucketCount;           // 2^subBucketBits
+    int64 subBucketHalf;            // 2^(subBucketBits-1)
+    std::vector<int64> counts;
+    int64 numValues;
+    int64 numOverflows;             // values beyond the last bucket
+    int64 minValue;
+    int64 maxValue;
+    double sum;
+
+  protected:
+    static int floorLog2(uint64 value)
+    {
+#ifdef __GNUC__
+        return 63 - __builtin_clzll(value);
+#else
+        int n = 0;
+        while (value >>= 1)
+            n++;
+        return n;
+#endif
+    }
+
+    int bucketIndex(int64 value) const
+    {
+        if (value < subBucketCount)
+            return (int)value;
+        int shift = floorLog2(value) - (subBucketBits - 1);
+        return (int)(subBucketCount + (shift - 1) * subBucketHalf + ((value >> shift) - subBucketHalf));
+    }
+
+    int64 bucketLowValue(int index) const;
+    int64 bucketWidth(int index) const;
+
+  public:
+    LogLinearHistogram(int subBucketBits = 7, int valueBits = 40);
+
+    void collect(int64 value)
+    {
+        if (value < 0)
+            value = 0;
+        int index = bucketIndex(value);
+        if (index >= (int)counts.size())
+        {
+            index = counts.size() - 1;
+            numOverflows++;
+        }
+        counts[index]++;
+        if (numValues == 0 || value < minValue)
+            minValue = value;
+        if (numValues == 0 || value > maxValue)
+            maxValue = value;
+        numValues++;
+        sum += value;
+    }
+
+    void clear();
+
+    /**
+     * Adds the counts of other, which must have the same layout.
+     */
+    void merge(const LogLinearHistogram& other);
+
+    int64 getCount() const { return numValues; }
+    int64 getOverflowCount() const { return numOverflows; }
+    int64 getMin() const { return minValue; }
+    int64 getMax() const { return maxValue; }
+    double getMean() const { return numValues ? sum / numValues : 0; }
+
+    /**
+     * Value below which percentile percent of the values fall (midpoint of
+     * the bucket, clamped to the observed minimum and maximum).
+     */
+    int64 getPercentile(double percentile) const;
+
+    /**
+     * Records count, mean, p50, p99, p99.99 and max as scalars of component
+     * named "<name> <statistic>", the values multiplied by scale.
+     */
+    void recordAs(cComponent *component, const char *name, double scale, const char *unit) const;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include <stdio.h>
+
+#include "ObjectPool.h"
+
+std::vector<ObjectPool *>& ObjectPool::pools()
+{
+    static std::vector<ObjectPool *> *all = new std::vector<ObjectPool *>();
+    return *all;
+}
+
+ObjectPool::ObjectPool(const char *typeName, size_t blockSize)
+{
+    this->typeName = typeName;
+    this->blockSize = blockSize;
+    numRequests = numReuses = 0;
+    pools().push_back(this);
+}
+
+void ObjectPool::recordScalars(cComponent *component)
+{
+    char name[128];
+    std::vector<ObjectPool *>& all = pools();
+    for (unsigned int i = 0; i < all.size(); i++)
+    {
+        ObjectPool *pool = all[i];
+        snprintf(name, sizeof(name), "pool %s allocations", pool->typeName);
+        component->recordScalar(name, pool->numRequests);
+        snprintf(name, sizeof(name), "pool %s reuses", pool->typeName);
+        component->recordScalar(name, pool->numReuses);
+        snprintf(name, sizeof(name), "pool %s hit rate (%%)", pool->typeName);
+        component->recordScalar(name, pool->numRequests ? 100.0 * pool->numReuses / pool->numRequests : 0);
+    }
+}
+
+void ObjectPool::resetCounters()
+{
+    std::vector<ObjectPool *>& all = pools();
+    for (unsigned int i = 0; i < all.size(); i++)
+        all[i]->numRequests = all[i]->numReuses = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef __INET_OBJECTPOOL_H
+#define __INET_OBJECTPOOL_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+/**
+ * Free list of memory blocks of one size. Blocks of other sizes (e.g. of a
+ * further subclass) go to the general-purpose allocator.
+ */
+class INET_API ObjectPool
+{
+  protected:
+    enum { MAX_FREE_BLOCKS = 4096 };    // beyond this, released blocks are freed
+
+    const char *typeName;
+    size_t blockSize;
+    std::vector<void *> freeBlocks;
+    long numRequests;       // allocations since the last report
+    long numReuses;         // of which served from the free list
+
+    static std::vector<ObjectPool *>& pools();
+
+  public:
+    ObjectPool(const char *typeName, size_t blockSize);
+
+    void *allocate(size_t size)
+    {
+        if (size != blockSize)
+            return ::operator new(size);
+        numRequests++;
+        if (freeBlocks.empty())
+            return ::operator new(size);
+        numReuses++;
+        void *block = freeBlocks.back();
+        freeBlocks.pop_back();
+        return block;
+    }
+
+    void release(void *block, size_t size)
+    {
+        if (size != blockSize || freeBlocks.size() >= MAX_FREE_BLOCKS)
+            ::operator delete(block);
+        else
+            freeBlocks.push_back(block);
+    }
+
+    /**
+     * Records "pool <type> allocations", "... reuses" and "... hit rate" of
+     * every pool as scalars of component. Called once per run, by the
+     * ObjectPoolStatistics module.
+     */
+    static void recordScalars(cComponent *component);
+
+    /**
+     * Restarts the counters of every pool.
+     */
+    static void resetCounters();
+};
+
+/**
+ * T allocated from a per-type ObjectPool: the object is constructed afresh
+ * on every allocation, but its memory is recycled when it is deleted, by any
+ * module, through a pointer to T. dup() returns a pooled copy and
+ * getClassName() the name of T, so the object is indistinguishable from a
+ * T (also when it is serialized in a parallel simulation).
+ *
+ * <pre>
+ * Ieee802Ctrl *etherctrl = new Pooled<Ieee802Ctrl>();
+ * </pre>
+ */
+template <class T>
+class Pooled : public T
+{
+  protected:
+    static ObjectPool& pool()
+    {
+        // never destroyed: objects may be deleted during static destruction
+        static ObjectPool *p = new ObjectPool(opp_typename(typeid(T)), sizeof(Pooled<T>));
+        return *p;
+    }
+
+  public:
+    Pooled() {}
+    explicit Pooled(const char *name) : T(name) {}
+    Pooled(const Pooled& other) : T(other) {}
+
+    virtual Pooled *dup() const { return new Pooled(*this); }
+    virtual const char *getClassName() const { return opp_typename(typeid(T)); }
+
+    static void *operator new(size_t size) { return pool().allocate(size); }
+    static void operator delete(void *block, size_t size) { pool().release(block, size); }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "ObjectPoolStatistics.h"
+
+#include "ObjectPool.h"
+
+Define_Module(ObjectPoolStatistics);
+
+void ObjectPoolStatistics::initialize()
+{
+    // the pools outlive the run: counting starts afresh with every run
+    ObjectPool::resetCounters();
+}
+
+void ObjectPoolStatistics::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("This module doesn't handle messages");
+}
+
+void ObjectPoolStatistics::finish()
+{
+    ObjectPool::recordScalars(this);
+}
@@ -0,0 +1,19 @@
+#ifndef __INET_OBJECTPOOLSTATISTICS_H
+#define __INET_OBJECTPOOLSTATISTICS_H
+
+#include "INETDefs.h"
+
+/**
+ * Records the statistics of all object pools (see ObjectPool) as scalars of
+ * this module at the end of the run. The pools are shared by every module
+ * of the simulation, so the network needs exactly one instance.
+ */
+class INET_API ObjectPoolStatistics : public cSimpleModule
+{
+  protected:
+    virtual void initialize();
+    virtual void handleMessage(cMessage *msg);
+    virtual void finish();
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "ScheduleStore.h"
+#include "VLTable.h"
+#include "WallClock.h"
+
+Define_Module(ScheduleStore);
+
+simsignal_t ScheduleStore::commitDurationSignal = registerSignal("commitDuration");
+simsignal_t ScheduleStore::updatesPerCommitSignal = registerSignal("updatesPerCommit");
+
+ScheduleStore::ScheduleStore()
+{
+    VLWindows empty = {0, 0, 0, 0, 0};
+    VLParams none = {NULL, NULL, NULL, NULL, NULL};
+
+    // el tamaño es fijo para que los punteros a las ventanas no se invaliden
+    windows.assign(SCHEDULE_MAX_VLS, empty);
+    shadow.assign(SCHEDULE_MAX_VLS, empty);
+    dirty.assign(SCHEDULE_MAX_VLS, false);
+    params.assign(SCHEDULE_MAX_VLS, none);
+    mirrorParameters = true;
+    staticSchedule = false;
+    recordCommitDuration = false;
+    commitMsg = NULL;
+}
+
+ScheduleStore::~ScheduleStore()
+{
+    cancelAndDelete(commitMsg);
+}
+
+ScheduleStore *ScheduleStore::findFor(cModule *switchModule)
+{
+    return dynamic_cast<ScheduleStore *>(switchModule->getSubmodule("scheduleStore"));
+}
+
+static long requiredAttribute(cXMLElement *element, const char *name)
+{
+    const char *value = element->getAttribute(name);
+    if (!value)
+        throw cRuntimeError("Missing attribute '%s' at %s", name, element->getSourceLocation());
+    return atol(value);
+}
+
+void ScheduleStore::checkVLId(int vlId)
+{
+    if (vlId < 0 || vlId >= SCHEDULE_MAX_VLS)
+        throw cRuntimeError("VL id %d out of range (max %d)", vlId, SCHEDULE_MAX_VLS - 1);
+}
+
+void ScheduleStore::initialize()
+{
+    mirrorParameters = par("mirrorParameters").boolValue();
+    cycleTime = par("cycleTime");
+    if (cycleTime < SIMTIME_ZERO)
+        error("Invalid cycleTime parameter");
+    recordCommitDuration = par("recordCommitDuration").boolValue();
+
+    commitMsg = new cMessage("commitSchedule");
+
+    numCommits = numUpdates = 0;
+    WATCH(numCommits);
+    WATCH(numUpdates);
+
+    // Se toman como ventanas iniciales las configuradas en los módulos
+    // <vl>_ctc y <vl> del switch
+    for (cModule::SubmoduleIterator it(getParentModule()); !it.end(); it++)
+    {
+        cModule *submodule = it();
+        const char *name = submodule->getName();
+        size_t len = strlen(name);
+
+        if (len > 4 && strcmp(name + len - 4, "_ctc") == 0)
+        {
+            char nombremoduloout[24];
+            if (len - 4 >= sizeof(nombremoduloout))
+                continue;
+            strncpy(nombremoduloout, name, len - 4);
+            nombremoduloout[len - 4] = '\0';
+
+            int vlId = VLTable::parseVLId(nombremoduloout);
+            if (vlId < 0)
+                continue;
+            checkVLId(vlId);
+
+            VLParams& p = params[vlId];
+            p.receiveWindowStart = &submodule->par("receive_window_start");
+            p.receiveWindowEnd = &submodule->par("receive_window_end");
+            p.permanencePit = &submodule->par("permanence_pit");
+
+            VLWindows& w = windows[vlId];
+            w.receiveWindowStart = p.receiveWindowStart->longValue();
+            w.receiveWindowEnd = p.receiveWindowEnd->longValue();
+            w.permanencePit = p.permanencePit->longValue();
+            shadow[vlId] = w;
+        }
+        else
+        {
+            int vlId = VLTable::parseVLId(name);
+            if (vlId < 0)
+                continue;
+            checkVLId(vlId);
+
+            VLParams& p = params[vlId];
+            p.sendWindowStart = &submodule->par("sendWindowStart");
+            p.sendWindowEnd = &submodule->par("sendWindowEnd");
+
+            VLWindows& w = windows[vlId];
+            w.sendWindowStart = p.sendWindowStart->longValue();
+            w.sendWindowEnd = p.sendWindowEnd->longValue();
+            shadow[vlId] = w;
+        }
+    }
+
+    loadStaticSchedule(par("staticSchedule").xmlValue());
+}
+
+void ScheduleStore::loadStaticSchedule(cXMLElement *schedule)
+{
+    if (!schedule)
+        return;
+
+    const char *switchName = getParentModule()->getName();
+    cXMLElementList switches = schedule->getChildrenByTagName("switch");
+
+    for (cXMLElementList::iterator sw = switches.begin(); sw != switches.end(); sw++)
+    {
+        const char *name = (*sw)->getAttribute("name");
+        if (!name || strcmp(name, switchName) != 0)
+            continue;
+
+        cXMLElementList vls = (*sw)->getChildrenByTagName("vl");
+        for (cXMLElementList::iterator it = vls.begin(); it != vls.end(); it++)
+        {
+            cXMLElement *vlElement = *it;
+            const char *id = vlElement->getAttribute("id");
+            if (!id)
+                throw cRuntimeError("Schedule entry without id at %s", vlElement->getSourceLocation());
+
+            int vlId = atoi(id);
+            checkVLId(vlId);
+
+            VLWindows& w = windows[vlId];
+            w.receiveWindowStart = requiredAttribute(vlElement, "receiveWindowStart");
+            w.receiveWindowEnd = requiredAttribute(vlElement, "receiveWindowEnd");
+            w.permanencePit = requiredAttribute(vlElement, "permanencePit");
+            w.sendWindowStart = requiredAttribute(vlElement, "sendWindowStart");
+            w.sendWindowEnd = requiredAttribute(vlElement, "sendWindowEnd");
+            shadow[vlId] = w;
+
+            if (mirrorParameters)
+                mirror(vlId);
+            staticSchedule = true;
+        }
+    }
+
+    if (staticSchedule)
+        EV << "Static schedule loaded for " << switchName << ", runtime reconfiguration disabled\n";
+}
+
+void ScheduleStore::handleMessage(cMessage *msg)
+{
+    if (msg == commitMsg)
+        commit();
+    else
+        throw cRuntimeError("Unknown message received");
+}
+
+VLWindows& ScheduleStore::beginUpdate(int vlId)
+{
+    Enter_Method_Silent();
+
+    checkVLId(vlId);
+    numUpdates++;
+    if (!dirty[vlId])
+    {
+        dirty[vlId] = true;
+        dirtyList.push_back(vlId);
+    }
+    return shadow[vlId];
+}
+
+void ScheduleStore::endUpdate()
+{
+    Enter_Method_Silent();
+
+    // sin ciclo la actualización se aplica en el mismo evento que la escribió
+    if (cycleTime > SIMTIME_ZERO)
+        scheduleCommit();
+    else
+        commit();
+}
+
+void ScheduleStore::setWindows(int vlId, long receiveStart, long receiveEnd, long permanencePit, long sendStart, long sendEnd)
+{
+    // ambas ventanas en una sola actualización: nunca se aplica una sin la otra
+    VLWindows& w = beginUpdate(vlId);
+    w.receiveWindowStart = receiveStart;
+    w.receiveWindowEnd = receiveEnd;
+    w.permanencePit = permanencePit;
+    w.sendWindowStart = sendStart;
+    w.sendWindowEnd = sendEnd;
+    endUpdate();
+}
+
+void ScheduleStore::scheduleCommit()
+{
+    if (commitMsg->isScheduled())
+        return;
+
+    // próximo inicio de ciclo estrictamente posterior al instante actual
+    simtime_t commitTime = (floor(simTime() / cycleTime) + 1) * cycleTime;
+    scheduleAt(commitTime, commitMsg);
+}
+
+void ScheduleStore::commit()
+{
+    // el tiempo real depende de la máquina: sólo se mide si se pide
+    double start = recordCommitDuration ? wallClockNow() : 0;
+
+    long updates = dirtyList.size();
+    for (std::vector<int>::iterator it = dirtyList.begin(); it != dirtyList.end(); it++)
+    {
+        windows[*it] = shadow[*it];
+        dirty[*it] = false;
+        if (mirrorParameters)
+            mirror(*it);
+    }
+    dirtyList.clear();
+    numCommits++;
+
+    EV << "Schedule committed, " << updates << " VLs updated\n";
+
+    emit(updatesPerCommitSignal, updates);
+    if (recordCommitDuration)
+        emit(commitDurationSignal, wallClockNow() - start);
+}
+
+void ScheduleStore::mirror(int vlId)
+{
+    const VLWindows& w = windows[vlId];
+    const VLParams& p = params[vlId];
+
+    if (p.receiveWindowStart)
+    {
+        p.receiveWindowStart->setLongValue(w.receiveWindowStart);
+        p.receiveWindowEnd->setLongValue(w.receiveWindowEnd);
+        p.permanencePit->setLongValue(w.permanencePit);
+    }
+    if (p.sendWindowStart)
+    {
+        p.sendWindowStart->setLongValue(w.sendWindowStart);
+        p.sendWindowEnd->setLongValue(w.sendWindowEnd);
+    }
+}
+
+void ScheduleStore::finish()
+{
+    recordScalar("number of schedule commits", numCommits);
+    recordScalar("number of schedule updates", numUpdates);
+}
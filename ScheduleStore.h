@@ -0,0 +1,116 @@
+#ifndef __INET_SCHEDULESTORE_H
+#define __INET_SCHEDULESTORE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+// cantidad máxima de VLs (identificadores 0..SCHEDULE_MAX_VLS-1)
+#define SCHEDULE_MAX_VLS    1024
+
+/**
+ * Ventanas de recepción (módulo <vl>_ctc) y de envío (módulo <vl>) de un VL.
+ */
+struct VLWindows
+{
+    long receiveWindowStart;
+    long receiveWindowEnd;
+    long permanencePit;
+    long sendWindowStart;
+    long sendWindowEnd;
+};
+
+/**
+ * Almacén de las ventanas de todos los VLs de un switch. Las ventanas se
+ * guardan en un arreglo plano indexado por identificador de VL, cuyo tamaño
+ * es fijo, de modo que los punteros devueltos por getWindows() son válidos
+ * durante toda la simulación.
+ *
+ * Cada reconfiguración de un VL (setWindows()) escribe sus ventanas de
+ * recepción y de envío juntas, en una copia (shadow), de modo que un VL nunca
+ * observa una ventana de recepción nueva junto con una ventana de envío
+ * anterior. Con cycleTime > 0 las reconfiguraciones se acumulan y se aplican
+ * todas juntas en el próximo inicio de ciclo (múltiplo de cycleTime), con un
+ * único evento y un único intercambio por ciclo; cycleTime debe ser entonces
+ * el ciclo del schedule de la red. Con cycleTime = 0 (valor por defecto) cada
+ * reconfiguración se aplica inmediatamente, dentro del evento que la escribió.
+ *
+ * Si el parámetro staticSchedule contiene ventanas para este switch (ver
+ * tools/schedule_synth.py), éstas se cargan en initialize() y el switch no
+ * realiza la reconfiguración en tiempo de ejecución.
+ *
+ * Si mirrorParameters es true, cada actualización aplicada se replica en los
+ * parámetros de los módulos <vl>_ctc y <vl> (mediante punteros a cPar
+ * resueltos en initialize()) para los módulos que todavía leen sus ventanas
+ * de ellos.
+ */
+class INET_API ScheduleStore : public cSimpleModule
+{
+  protected:
+    struct VLParams
+    {
+        cPar *receiveWindowStart;
+        cPar *receiveWindowEnd;
+        cPar *permanencePit;
+        cPar *sendWindowStart;
+        cPar *sendWindowEnd;
+    };
+
+    std::vector<VLWindows> windows;     // ventanas vigentes
+    std::vector<VLWindows> shadow;      // ventanas a aplicar en el próximo ciclo
+    std::vector<bool> dirty;
+    std::vector<int> dirtyList;
+    std::vector<VLParams> params;
+    bool mirrorParameters;
+    bool staticSchedule;                // ventanas fijas cargadas de un schedule sintetizado
+    simtime_t cycleTime;
+    bool recordCommitDuration;          // tiempo real de los commits, sólo para perfilado
+
+    cMessage *commitMsg;
+
+    // statistics
+    long numCommits;
+    long numUpdates;
+    static simsignal_t commitDurationSignal;
+    static simsignal_t updatesPerCommitSignal;
+
+  protected:
+    virtual void initialize();
+    virtual void handleMessage(cMessage *msg);
+    virtual void finish();
+
+    virtual void loadStaticSchedule(cXMLElement *schedule);
+    virtual VLWindows& beginUpdate(int vlId);
+    virtual void endUpdate();
+    virtual void scheduleCommit();
+    virtual void commit();
+    virtual void mirror(int vlId);
+
+    static void checkVLId(int vlId);
+
+  public:
+    ScheduleStore();
+    virtual ~ScheduleStore();
+
+    /**
+     * Devuelve el almacén del switch, o NULL si el switch no tiene uno.
+     */
+    static ScheduleStore *findFor(cModule *switchModule);
+
+    const VLWindows *getWindows(int vlId) const { checkVLId(vlId); return &windows[vlId]; }
+
+    /**
+     * true si las ventanas del switch provienen de un schedule sintetizado
+     * (parámetro staticSchedule); en ese caso no se reconfiguran en tiempo
+     * de ejecución.
+     */
+    bool isStatic() const { return staticSchedule; }
+
+    /**
+     * Reconfigura las ventanas de recepción y de envío de un VL en una única
+     * actualización (un único commit con cycleTime = 0).
+     */
+    virtual void setWindows(int vlId, long receiveStart, long receiveEnd, long permanencePit, long sendStart, long sendEnd);
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "VLTable.h"
+
+VLEntry::VLEntry()
+{
+    vlId = -1;
+    owner = moduloin = moduloout = NULL;
+    ownerSendWindowStart = NULL;
+    sourceWindowStart = 0;
+    receiveOffset = receiveLength = sendStartOffset = sendEndOffset = 0;
+    notifyControl = false;
+}
+
+static int intAttribute(cXMLElement *element, const char *name, int defaultValue)
+{
+    const char *value = element->getAttribute(name);
+    return value ? atoi(value) : defaultValue;
+}
+
+int VLTable::parseVLId(const char *name)
+{
+    if (strncmp(name, "vl_", 3) != 0)
+        return -1;
+
+    const char *p = name + 3;
+    if (!*p)
+        return -1;
+
+    int id = 0;
+    for (; *p; p++)
+    {
+        if (*p < '0' || *p > '9')
+            return -1;
+        id = id * 10 + (*p - '0');
+    }
+    return id;
+}
+
+void VLTable::load(cXMLElement *config, cModule *switchModule)
+{
+    entries.clear();
+
+    if (!config)
+        return;
+
+    cModule *red = switchModule->getParentModule();
+    cXMLElementList switches = config->getChildrenByTagName("switch");
+
+    for (cXMLElementList::iterator sw = switches.begin(); sw != switches.end(); sw++)
+    {
+        const char *switchName = (*sw)->getAttribute("name");
+        if (!switchName || strcmp(switchName, switchModule->getName()) != 0)
+            continue;
+
+        cXMLElementList vls = (*sw)->getChildrenByTagName("vl");
+        for (cXMLElementList::iterator it = vls.begin(); it != vls.end(); it++)
+        {
+            cXMLElement *vlElement = *it;
+            const char *source = vlElement->getAttribute("source");
+            if (!source)
+                throw cRuntimeError("VL entry without source ECU at %s", vlElement->getSourceLocation());
+
+            cModule *nodo = red->getSubmodule(source);
+            if (!nodo)
+                throw cRuntimeError("Source ECU '%s' not found at %s", source, vlElement->getSourceLocation());
+
+            const char *id = vlElement->getAttribute("id");
+            const char *lastDigit = vlElement->getAttribute("lastDigit");
+
+            if (nodo->isPlaceholder() || vlElement->getAttribute("sourceWindowStart"))
+            {
+                // ECU en otra partición: no se accede a sus submódulos
+                if (!id || !vlElement->getAttribute("sourceWindowStart"))
+                    throw cRuntimeError("Source ECU '%s' is in another partition: VL entry needs the id and "
+                            "sourceWindowStart attributes at %s", source, vlElement->getSourceLocation());
+                addEntry(vlElement, atoi(id), NULL, switchModule);
+            }
+            else if (id)
+            {
+                char vlName[16];
+                sprintf(vlName, "vl_%d", atoi(id));
+                cModule *owner = nodo->getSubmodule(vlName);
+                if (!owner)
+                    throw cRuntimeError("VL '%s' not found in ECU '%s' at %s", vlName, source, vlElement->getSourceLocation());
+                addEntry(vlElement, atoi(id), owner, switchModule);
+            }
+            else if (lastDigit)
+            {
+                // se expande a todos los VLs de la ECU que terminan en el dígito indicado
+                // y que tienen módulos de ingreso/egreso en este switch
+                for (cModule::SubmoduleIterator sub(nodo); !sub.end(); sub++)
+                {
+                    cModule *owner = sub();
+                    int vlId = parseVLId(owner->getName());
+                    if (vlId < 0 || vlId % 10 != atoi(lastDigit))
+                        continue;
+
+                    char nombremoduloin[24];
+                    sprintf(nombremoduloin, "%s_ctc", owner->getName());
+                    if (switchModule->getSubmodule(nombremoduloin) && switchModule->getSubmodule(owner->getName()))
+                        addEntry(vlElement, vlId, owner, switchModule);
+                }
+            }
+            else
+                throw cRuntimeError("VL entry needs an id or lastDigit attribute at %s", vlElement->getSourceLocation());
+        }
+    }
+}
+
+void VLTable::addEntry(cXMLElement *vlElement, int vlId, cModule *owner, cModule *switchModule)
+{
+    if (vlId >= (int)entries.size())
+        entries.resize(vlId + 1);
+
+    VLEntry& entry = entries[vlId];
+    if (entry.vlId >= 0)
+        return;     // prevalece la primera entrada
+
+    char nombremoduloout[16], nombremoduloin[24];
+    sprintf(nombremoduloout, "vl_%d", vlId);
+    sprintf(nombremoduloin, "%s_ctc", nombremoduloout);
+
+    entry.moduloin = switchModule->getSubmodule(nombremoduloin);
+    entry.moduloout = switchModule->getSubmodule(nombremoduloout);
+    if (!entry.moduloin || !entry.moduloout)
+        throw cRuntimeError("Switch '%s' has no '%s'/'%s' modules for VL %d",
+                switchModule->getFullPath().c_str(), nombremoduloin, nombremoduloout, vlId);
+
+    entry.vlId = vlId;
+    entry.owner = owner;
+
+    if (owner)
+        entry.ownerSendWindowStart = &owner->par("sendWindowStart");
+    else
+        entry.sourceWindowStart = intAttribute(vlElement, "sourceWindowStart", 0);
+
+    entry.receiveOffset = intAttribute(vlElement, "receiveOffset", 5);
+    entry.receiveLength = intAttribute(vlElement, "receiveLength", 10);
+    entry.sendStartOffset = intAttribute(vlElement, "sendStart", entry.receiveLength + 1);
+    entry.sendEndOffset = intAttribute(vlElement, "sendEnd", entry.sendStartOffset + 1);
+
+    const char *notify = vlElement->getAttribute("notify");
+    entry.notifyControl = notify && strcmp(notify, "true") == 0;
+}
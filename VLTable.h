@@ -0,0 +1,102 @@
+#ifndef __INET_VLTABLE_H
+#define __INET_VLTABLE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+/**
+ * Entrada de la tabla de virtual links de un switch. Contiene los módulos
+ * involucrados en la reconfiguración de ventanas del VL y los desplazamientos
+ * con los que se calculan dichas ventanas a partir del sendWindowStart de la
+ * ECU que origina el flujo.
+ */
+struct VLEntry
+{
+    int vlId;                       // -1 si la entrada está vacía
+
+    cModule *owner;                 // VL de origen dentro de la ECU, NULL si la ECU está en otra partición
+    cModule *moduloin;              // módulo de ingreso <vl>_ctc del switch
+    cModule *moduloout;             // módulo de egreso <vl> del switch
+
+    // parámetro resuelto una única vez en initialize(); NULL si la ECU
+    // está en otra partición y se usa sourceWindowStart
+    cPar *ownerSendWindowStart;
+    int sourceWindowStart;
+
+    // tempo = sendWindowStart(owner) + receiveOffset
+    int receiveOffset;
+    int receiveLength;              // receive_window_end = permanence_pit = tempo + receiveLength
+    int sendStartOffset;            // sendWindowStart = tempo + sendStartOffset
+    int sendEndOffset;              // sendWindowEnd = tempo + sendEndOffset
+
+    bool notifyControl;             // se informa el tiempo de llegada a appControl
+
+    VLEntry();
+
+    int sendWindowStart() const
+    {
+        return ownerSendWindowStart ? (int)ownerSendWindowStart->longValue() : sourceWindowStart;
+    }
+};
+
+/**
+ * Tabla de clasificación de virtual links de un switch, construida a partir
+ * del archivo de configuración XML (ver vlconfig.xml). La búsqueda por
+ * identificador de VL es un acceso directo a un vector.
+ *
+ * Formato:
+ * <pre>
+ * <vlconfig>
+ *     <switch name="switch_1">
+ *         <vl id="227" source="señalizador" receiveOffset="5" receiveLength="5"
+ *             sendStart="6" sendEnd="7" notify="true"/>
+ *         <vl lastDigit="4" source="freno" notify="true"/>
+ *     </switch>
+ * </vlconfig>
+ * </pre>
+ *
+ * Las entradas con el atributo lastDigit se expanden a todos los VLs de la
+ * ECU indicada cuyo identificador termina en ese dígito. Ante entradas
+ * repetidas prevalece la primera.
+ *
+ * En simulación paralela la ECU de origen puede estar en otra partición
+ * (placeholder) y su parámetro sendWindowStart no es accesible. En ese caso
+ * la entrada debe indicar el id del VL y el atributo sourceWindowStart, que
+ * también puede usarse en simulación secuencial para fijar el valor.
+ */
+class INET_API VLTable
+{
+  protected:
+    std::vector<VLEntry> entries;   // indexado por identificador de VL
+
+  protected:
+    void addEntry(cXMLElement *vlElement, int vlId, cModule *owner, cModule *switchModule);
+
+  public:
+    /**
+     * Carga las entradas correspondientes a switchModule. Los módulos de
+     * origen se buscan en la red que contiene al switch.
+     */
+    void load(cXMLElement *config, cModule *switchModule);
+
+    /**
+     * Devuelve la entrada del VL, o NULL si el switch no lo reconfigura.
+     */
+    const VLEntry *lookup(int vlId) const
+    {
+        if (vlId < 0 || vlId >= (int)entries.size() || entries[vlId].vlId < 0)
+            return NULL;
+        return &entries[vlId];
+    }
+
+    bool isEmpty() const { return entries.empty(); }
+
+    /**
+     * Obtiene el identificador numérico a partir del nombre "vl_<id>".
+     * Devuelve -1 si el nombre no corresponde a un VL.
+     */
+    static int parseVLId(const char *name);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __INET_WALLCLOCK_H
+#define __INET_WALLCLOCK_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * Returns a monotonic wall-clock timestamp in seconds. Only differences
+ * between two calls are meaningful; used for measuring the real time spent
+ * in simulation code, not simulation time.
+ */
+inline double wallClockNow()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+#endif
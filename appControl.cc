@@ -5,8 +5,10 @@
 #include "appControl.h"
 
 #include "Ieee802Ctrl_m.h"
+#include "VLConfig_m.h"
 #include "NodeOperations.h"
 #include "ModuleAccess.h"
+#include "ObjectPool.h"
 
 Define_Module(appControl);
 
@@ -64,18 +66,18 @@ void appControl::handleMessage(cMessage *msg)
     }
     else{
 
-        // Se generan los paquetes de configuración que serán enviados al módulo gestor el cual los distribuirá
+        // Se completan los paquetes de configuración que serán enviados al módulo gestor el cual los distribuirá
         // a los otros Switches
 
-        std::string msgname = msg->getName();
-        std::string mensaje = "configuracion " + msgname;
-        const char * c = mensaje.c_str();
-
-        cPacket *datapacket = new cPacket(c, IEEE802CTRL_DATA);
+        VLConfigPacket *datapacket = check_and_cast<VLConfigPacket *>(msg);
+        datapacket->setKind(IEEE802CTRL_DATA);
+        // las versiones sólo están ordenadas entre las configuraciones de un mismo switch
+        datapacket->setOrigin(findContainingNode(this)->getId());
+        datapacket->setVersion(++configVersion[datapacket->getVlId()]);
         long len = packetLength->longValue();
         datapacket->setByteLength(len);
 
-        Ieee802Ctrl *etherctrl = new Ieee802Ctrl();
+        Ieee802Ctrl *etherctrl = new Pooled<Ieee802Ctrl>();
         etherctrl->setEtherType(etherType);
         etherctrl->setDest(destMACAddress);
         datapacket->setControlInfo(etherctrl);
@@ -0,0 +1,61 @@
+#ifndef __INET_APPCONTROL_H
+#define __INET_APPCONTROL_H
+
+#include <map>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+#include "NodeStatus.h"
+#include "ILifecycle.h"
+
+/**
+ * Agente del switch: recibe del módulo EtherMACFullDuplex los tiempos de
+ * llegada de los VLs y los envía como paquetes de configuración al módulo
+ * de gestión de tráfico.
+ */
+class INET_API appControl : public cSimpleModule, public ILifecycle
+{
+  protected:
+    enum Kinds {START=100, NEXT};
+
+    long seqNum;
+
+    // send parameters
+    cPar *sendInterval;
+    cPar *numPacketsPerBurst;
+    cPar *packetLength;
+    int etherType;
+    MACAddress destMACAddress;
+    NodeStatus *nodeStatus;
+
+    // self messages
+    cMessage *timerMsg;
+    simtime_t startTime;
+    simtime_t stopTime;
+
+    // última versión de configuración enviada por VL
+    std::map<int, int> configVersion;
+
+    // receive statistics
+    long packetsSent;
+    long packetsReceived;
+    static simsignal_t sentPkSignal;
+    static simsignal_t rcvdPkSignal;
+
+  public:
+    appControl();
+    virtual ~appControl();
+
+    virtual bool handleOperationStage(LifecycleOperation *operation, int stage, IDoneCallback *doneCallback);
+
+  protected:
+    virtual void initialize(int stage);
+    virtual int numInitStages() const { return 4; }
+    virtual void handleMessage(cMessage *msg);
+    virtual void finish();
+
+    virtual void receivePacket(cPacket *msg);
+};
+
+#endif
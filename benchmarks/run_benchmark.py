@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+Events-per-second benchmark for the in-vehicle network simulation.
+
+Runs every case listed in benchmark.json headless (Cmdenv, express mode) for a
+fixed simulated time and reports, per case:
+
+  - wall time and events per second,
+  - peak resident set size of the simulation process,
+  - frames per simulated second for every module that records frame
+    counters (EtherMACFullDuplex, Ieee8021dRelay, traffic modules).
+
+Prerequisites: the harness runs the simulation project built from this
+repository, which is not part of it. The default definition expects, relative
+to this directory,
+
+  ../in_vehicle_detnet         the simulation executable (opp_makemake output
+                               linked against INET), built from this tree
+  ../simulations/omnetpp.ini   the in-vehicle network configuration of the
+                               "vehicle" case, with its NED files
+
+so the repository has to be checked out inside (or next to) the simulation
+project with that layout; adjust "command" and "ini" in benchmark.json
+otherwise. The scaled cases generate their network with tools/topogen.py but
+still need the executable and the NED types listed in its docstring. Missing
+files are reported before any case is run.
+
+Results are written to results/<case>.json and compared against the stored
+baseline (baseline.json); the script exits with status 1 if any case is
+slower than the baseline by more than --tolerance percent. Use
+--update-baseline to store the current results as the new baseline.
+
+benchmark.json format:
+
+    {
+      "command": ["../in_vehicle_detnet", "-u", "Cmdenv"],
+      "cases": [
+        {"name": "vehicle", "ini": "../simulations/omnetpp.ini", "config": "General",
+         "simTime": "10s"},
+        {"name": "scaled", "generate": ["python3", "../tools/topogen.py", "..."],
+         "ini": "generated/omnetpp.ini", "config": "Scaled", "simTime": "1s"}
+      ]
+    }
+
+A case may define "generate", a command run before the simulation (e.g. to
+produce a scaled-up topology), and "options", extra command line options
+for the simulation.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# frame counters recorded by the modules, and whether they are already rates
+FRAME_SCALARS = {
+    'frames/sec sent': True,
+    'frames/sec rcvd': True,
+    'number of received frames from network (including BPDUs)': False,
+    'number of dispatched non-BDPU frames to the network': False,
+    'packets sent': False,
+    'packets received': False,
+}
+
+# options that keep the measurement free of output and logging overhead
+COMMON_OPTIONS = [
+    '--cmdenv-express-mode=true',
+    '--cmdenv-performance-display=false',
+    '--record-eventlog=false',
+    '--**.vector-recording=false',
+    '--**.hotPathLogging=false',
+]
+
+
+def parse_simtime(text):
+    units = {'s': 1.0, 'ms': 1e-3, 'us': 1e-6, 'ns': 1e-9}
+    m = re.match(r'^\s*([0-9.eE+-]+)\s*([a-z]*)\s*$', text)
+    if not m:
+        raise ValueError('bad simulation time: %s' % text)
+    return float(m.group(1)) * units.get(m.group(2) or 's', 1.0)
+
+
+def check_prerequisites(command, cases, workdir):
+    """Fails with a clear message if the executable or an ini file is missing."""
+    missing = []
+    executable = command[0]
+    if os.sep in executable or executable.startswith('.'):
+        if not os.path.isfile(os.path.join(workdir, executable)):
+            missing.append('simulation executable %s' % executable)
+    for case in cases:
+        # generated ini files only exist after the case's generate step
+        if 'generate' not in case and not os.path.isfile(os.path.join(workdir, case['ini'])):
+            missing.append('%s of case %s' % (case['ini'], case['name']))
+    if missing:
+        raise SystemExit('missing prerequisites (relative to %s):\n  %s\n'
+                         'see the docstring of run_benchmark.py' % (workdir, '\n  '.join(missing)))
+
+
+def run_case(command, case, workdir):
+    if 'generate' in case:
+        subprocess.check_call(case['generate'], cwd=workdir)
+
+    sca = os.path.join(workdir, 'results', 'bench-%s.sca' % case['name'])
+    if os.path.exists(sca):
+        os.remove(sca)
+
+    args = list(command) + ['-f', case['ini'], '-c', case.get('config', 'General'), '-r', str(case.get('run', 0)),
+                            '--sim-time-limit=%s' % case['simTime'],
+                            '--output-scalar-file=%s' % sca] + COMMON_OPTIONS + case.get('options', [])
+
+    start = time.time()
+    proc = subprocess.Popen(args, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    output = proc.stdout.read()
+    # reap the child ourselves to get its own resource usage (ru_maxrss is in kB on Linux)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    proc.stdout.close()
+    returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+
+    if returncode != 0:
+        sys.stderr.write(output)
+        raise SystemExit('case %s: simulation failed with status %d' % (case['name'], returncode))
+
+    events = [int(n) for n in re.findall(r'event #(\d+)', output)]
+    if not events:
+        raise SystemExit('case %s: could not find the event count in the simulation output' % case['name'])
+    num_events = max(events)
+
+    return {
+        'case': case['name'],
+        'simTime': case['simTime'],
+        'wallTime': wall,
+        'events': num_events,
+        'eventsPerSecond': num_events / wall if wall > 0 else 0.0,
+        'peakRssKB': usage.ru_maxrss,
+        'framesPerSecond': frames_per_module(sca, parse_simtime(case['simTime'])),
+    }
+
+
+def frames_per_module(sca, simtime):
+    """Frames per simulated second per module, from the scalar file."""
+    result = {}
+    if not os.path.exists(sca):
+        return result
+    scalar = re.compile(r'^scalar\s+(\S+)\s+("[^"]*"|\S+)\s+(\S+)')
+    with open(sca) as f:
+        for line in f:
+            m = scalar.match(line)
+            if not m:
+                continue
+            module, name, value = m.group(1), m.group(2).strip('"'), m.group(3)
+            if name not in FRAME_SCALARS:
+                continue
+            try:
+                v = float(value)
+            except ValueError:
+                continue
+            rate = v if FRAME_SCALARS[name] else v / simtime
+            result.setdefault(module, {})[name] = rate
+    return result
+
+
+def compare(results, baseline, tolerance):
+    regressions = []
+    for r in results:
+        base = baseline.get(r['case'])
+        if not base:
+            print('  %-20s no baseline' % r['case'])
+            continue
+        delta = 100.0 * (r['eventsPerSecond'] - base['eventsPerSecond']) / base['eventsPerSecond']
+        rss = 100.0 * (r['peakRssKB'] - base['peakRssKB']) / max(base['peakRssKB'], 1)
+        print('  %-20s events/s %+6.1f%%   peak RSS %+6.1f%%' % (r['case'], delta, rss))
+        if delta < -tolerance:
+            regressions.append(r['case'])
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='In-vehicle network simulation benchmark')
+    parser.add_argument('--cases', default=os.path.join(HERE, 'benchmark.json'), help='benchmark definition')
+    parser.add_argument('--baseline', default=os.path.join(HERE, 'baseline.json'), help='stored baseline')
+    parser.add_argument('--only', action='append', help='run only the named case (repeatable)')
+    parser.add_argument('--tolerance', type=float, default=5.0, help='allowed events/s regression in percent')
+    parser.add_argument('--update-baseline', action='store_true', help='store the results as the new baseline')
+    args = parser.parse_args()
+
+    with open(args.cases) as f:
+        definition = json.load(f)
+    workdir = os.path.dirname(os.path.abspath(args.cases))
+    os.makedirs(os.path.join(workdir, 'results'), exist_ok=True)
+
+    selected = []
+    for case in definition['cases']:
+        if args.only and case['name'] not in args.only:
+            continue
+        selected.append(case)
+    check_prerequisites(definition['command'], selected, workdir)
+
+    results = []
+    for case in selected:
+        r = run_case(definition['command'], case, workdir)
+        results.append(r)
+        with open(os.path.join(workdir, 'results', '%s.json' % case['name']), 'w') as f:
+            json.dump(r, f, indent=2, sort_keys=True)
+        print('%-20s %8.2f s wall  %10.0f events/s  %8d kB peak RSS' %
+              (r['case'], r['wallTime'], r['eventsPerSecond'], r['peakRssKB']))
+        for module in sorted(r['framesPerSecond']):
+            for name, rate in sorted(r['framesPerSecond'][module].items()):
+                print('    %-50s %-40s %12.1f frames/s' % (module, name, rate))
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    print('comparison against %s:' % os.path.relpath(args.baseline))
+    regressions = compare(results, baseline, args.tolerance)
+
+    if args.update_baseline:
+        for r in results:
+            baseline[r['case']] = r
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+        print('baseline updated')
+    elif regressions:
+        raise SystemExit('regressions beyond %.1f%%: %s' % (args.tolerance, ', '.join(regressions)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,458 @@
+#!/usr/bin/env python3
+"""
+Reader of the columnar result files of ColumnarOutputVectorManager (.cvec)
+and ColumnarOutputScalarManager (.csca).
+
+The files are memory-mapped and only the index (at the end of the file) is
+parsed up front; the columns of a vector chunk are decoded only if they are
+needed. Scanning the value column of one vector across hundreds of runs
+therefore touches only the bytes of that column.
+
+  colreader.py vectors results/                 list the vectors of every run
+  colreader.py stats -n 'txPk*' results/        count/mean/min/max per run,
+                                                from the index alone
+  colreader.py scan -m '**.switch_1.eth[2].mac' -n 'rxPkOk*' \\
+      --column value results/ > values.csv      decode one column
+  colreader.py scalars -n '*latency p99*' results/
+  colreader.py histograms -n 'endToEndDelay*' results/
+
+Paths may be files or directories (searched recursively). Module and name
+filters are globs; '**' and '*' both match across dots. Output is CSV on
+stdout, one row per sample (scan), vector (stats, vectors), scalar or
+histogram bin. Vectors and scalars are listed with their unit, if recorded.
+
+The module can also be imported: open_result(path) returns a VectorFile or
+ScalarFile.
+"""
+
+import argparse
+import csv
+import fnmatch
+import mmap
+import os
+import struct
+import sys
+
+VECTOR_MAGIC = b'OMNCVEC1'
+SCALAR_MAGIC = b'OMNCSCA2'
+SCALAR_MAGIC_V1 = b'OMNCSCA1'   # no attributes nor histograms
+FOOTER_MAGIC = b'CIDX'
+FOOTER_SIZE = 16
+
+VALUES_INTEGER = 0
+VALUES_XOR = 1
+
+
+# -- decoding ----------------------------------------------------------------
+
+class Reader:
+    """Sequential decoder over a buffer (bytes or mmap)."""
+
+    def __init__(self, buf, pos=0):
+        self.buf = buf
+        self.pos = pos
+
+    def byte(self):
+        b = self.buf[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self):
+        buf, pos = self.buf, self.pos
+        result = shift = 0
+        while True:
+            b = buf[pos]
+            pos += 1
+            result |= (b & 0x7f) << shift
+            if b < 0x80:
+                break
+            shift += 7
+        self.pos = pos
+        return result
+
+    def svarint(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+    def fixed(self, n):
+        v = int.from_bytes(self.buf[self.pos:self.pos + n], 'little')
+        self.pos += n
+        return v
+
+    def double(self):
+        v = struct.unpack_from('<d', self.buf, self.pos)[0]
+        self.pos += 8
+        return v
+
+    def string(self):
+        n = self.varint()
+        s = bytes(self.buf[self.pos:self.pos + n]).decode('utf-8', 'replace')
+        self.pos += n
+        return s
+
+
+def decode_times(buf, offset, count):
+    r = Reader(buf, offset)
+    times = []
+    prev = delta = 0
+    for i in range(count):
+        v = r.svarint()
+        if i == 0:
+            prev = v
+        else:
+            delta += v
+            prev += delta
+        times.append(prev)
+    return times
+
+
+def decode_values(buf, offset, count, encoding):
+    r = Reader(buf, offset)
+    values = []
+    if encoding == VALUES_INTEGER:
+        prev = 0
+        for _ in range(count):
+            prev += r.svarint()
+            values.append(float(prev))
+    elif encoding == VALUES_XOR:
+        prev = 0
+        for _ in range(count):
+            header = r.byte()
+            leading, trailing = header >> 4, header & 0x0f
+            n = 8 - leading - trailing
+            x = r.fixed(n) << (8 * trailing) if n > 0 else 0
+            prev ^= x
+            values.append(struct.unpack('<d', prev.to_bytes(8, 'little'))[0])
+    else:
+        raise ValueError('unknown value encoding %d' % encoding)
+    return values
+
+
+# -- files -------------------------------------------------------------------
+
+class Chunk:
+    __slots__ = ('offset', 'count', 'time_bytes', 'value_bytes', 'encoding',
+                 'first_time', 'last_time', 'min', 'max', 'sum')
+
+
+class Vector:
+    def __init__(self, result, vector_id, module, name, attributes, chunks):
+        self.result = result
+        self.id = vector_id
+        self.module = module
+        self.name = name
+        self.attributes = attributes
+        self.chunks = chunks
+
+    @property
+    def count(self):
+        return sum(c.count for c in self.chunks)
+
+    @property
+    def sum(self):
+        return sum(c.sum for c in self.chunks)
+
+    @property
+    def min(self):
+        return min(c.min for c in self.chunks)
+
+    @property
+    def max(self):
+        return max(c.max for c in self.chunks)
+
+    def _selected(self, t0, t1):
+        for c in self.chunks:
+            if t0 is not None and c.last_time < t0:
+                continue
+            if t1 is not None and c.first_time > t1:
+                continue
+            yield c
+
+    def times(self, t0=None, t1=None):
+        """Sample times (seconds); only the time column is decoded."""
+        scale = self.result.time_scale
+        out = []
+        for c in self._selected(t0, t1):
+            out.extend(t * scale for t in decode_times(self.result.buf, c.offset, c.count))
+        return out
+
+    def values(self):
+        """Sample values; only the value column is decoded."""
+        out = []
+        for c in self.chunks:
+            out.extend(decode_values(self.result.buf, c.offset + c.time_bytes, c.count, c.encoding))
+        return out
+
+    def samples(self, t0=None, t1=None):
+        """(time, value) pairs, optionally restricted to [t0, t1] raw ticks."""
+        scale = self.result.time_scale
+        out = []
+        for c in self._selected(t0, t1):
+            times = decode_times(self.result.buf, c.offset, c.count)
+            values = decode_values(self.result.buf, c.offset + c.time_bytes, c.count, c.encoding)
+            for t, v in zip(times, values):
+                if (t0 is None or t >= t0) and (t1 is None or t <= t1):
+                    out.append((t * scale, v))
+        return out
+
+
+class ResultFile:
+    def __init__(self, path, magics):
+        self.path = path
+        self._file = open(path, 'rb')
+        self.buf = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        self.magic = bytes(self.buf[:8])
+        if self.magic not in magics:
+            raise ValueError('%s: not a columnar %s file' % (path, 'vector' if VECTOR_MAGIC in magics else 'scalar'))
+        if len(self.buf) < 8 + FOOTER_SIZE or self.buf[-4:] != FOOTER_MAGIC:
+            raise ValueError('%s: missing index (run not finished?)' % path)
+        footer = Reader(self.buf, len(self.buf) - FOOTER_SIZE)
+        index_offset = footer.fixed(8)
+        footer.fixed(4)
+        self.index = Reader(self.buf, index_offset)
+        self.attributes = {}
+        for _ in range(self.index.varint()):
+            key = self.index.string()
+            self.attributes[key] = self.index.string()
+        self.time_scale = 10.0 ** int(self.attributes.get('simtime-scale', '-12'))
+
+    @property
+    def run(self):
+        return self.attributes.get('runid', os.path.basename(self.path))
+
+    def close(self):
+        self.buf.close()
+        self._file.close()
+
+
+class VectorFile(ResultFile):
+    def __init__(self, path):
+        ResultFile.__init__(self, path, (VECTOR_MAGIC,))
+        r = self.index
+        self.vectors = []
+        for _ in range(r.varint()):
+            vector_id = r.varint()
+            module = r.string()
+            name = r.string()
+            attributes = {}
+            for _ in range(r.varint()):
+                key = r.string()
+                attributes[key] = r.string()
+            chunks = []
+            for _ in range(r.varint()):
+                c = Chunk()
+                c.offset = r.varint()
+                c.count = r.varint()
+                c.time_bytes = r.varint()
+                c.value_bytes = r.varint()
+                c.encoding = r.byte()
+                c.first_time = r.svarint()
+                c.last_time = r.svarint()
+                c.min = r.double()
+                c.max = r.double()
+                c.sum = r.double()
+                chunks.append(c)
+            self.vectors.append(Vector(self, vector_id, module, name, attributes, chunks))
+
+    def find(self, module='*', name='*'):
+        return [v for v in self.vectors if matches(v.module, module) and matches(v.name, name)]
+
+
+class ScalarFile(ResultFile):
+    def __init__(self, path):
+        ResultFile.__init__(self, path, (SCALAR_MAGIC, SCALAR_MAGIC_V1))
+        r = self.index
+        self.modules = [r.string() for _ in range(r.varint())]
+        self.names = [r.string() for _ in range(r.varint())]
+        self.count = r.varint()
+        self.columns = [(r.varint(), r.varint()) for _ in range(3)]
+        # (module, name) -> attributes of the scalar or statistic
+        self.attributes_of = {}
+        # (module, name) -> (edges, counts); counts has the underflow first
+        # and the overflow last, so len(counts) == len(edges) + 1
+        self.histograms = {}
+        if self.magic == SCALAR_MAGIC_V1:
+            return
+        for _ in range(r.varint()):
+            key = (self.modules[r.varint()], self.names[r.varint()])
+            attributes = {}
+            for _ in range(r.varint()):
+                k = r.string()
+                attributes[k] = r.string()
+            self.attributes_of[key] = attributes
+        for _ in range(r.varint()):
+            key = (self.modules[r.varint()], self.names[r.varint()])
+            n = r.varint()
+            edges = [r.double() for _ in range(n + 1)]
+            counts = [r.double() for _ in range(n + 2)]
+            self.histograms[key] = (edges, counts)
+
+    def unit(self, module, name):
+        """Unit of a scalar, or of the statistic a '<name>:field' scalar
+        belongs to (':count' has none)."""
+        attributes = self.attributes_of.get((module, name))
+        if attributes is None and ':' in name:
+            statistic, field = name.rsplit(':', 1)
+            if field != 'count':
+                attributes = self.attributes_of.get((module, statistic))
+        return attributes.get('unit', '') if attributes else ''
+
+    def scalars(self, module='*', name='*'):
+        """(module, name, value) of the matching scalars."""
+        wanted_modules = set(i for i, m in enumerate(self.modules) if matches(m, module))
+        wanted_names = set(i for i, n in enumerate(self.names) if matches(n, name))
+        if not wanted_modules or not wanted_names:
+            return []
+        mods = Reader(self.buf, self.columns[0][0])
+        nams = Reader(self.buf, self.columns[1][0])
+        values_offset = self.columns[2][0]
+        out = []
+        for i in range(self.count):
+            m = mods.varint()
+            n = nams.varint()
+            if m in wanted_modules and n in wanted_names:
+                value = struct.unpack_from('<d', self.buf, values_offset + 8 * i)[0]
+                out.append((self.modules[m], self.names[n], value))
+        return out
+
+
+def open_result(path):
+    with open(path, 'rb') as f:
+        magic = f.read(8)
+    if magic == VECTOR_MAGIC:
+        return VectorFile(path)
+    if magic in (SCALAR_MAGIC, SCALAR_MAGIC_V1):
+        return ScalarFile(path)
+    raise ValueError('%s: not a columnar result file' % path)
+
+
+def matches(text, pattern):
+    return fnmatch.fnmatchcase(text, pattern.replace('**', '*'))
+
+
+def find_files(paths, extension):
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, files in os.walk(path):
+                for name in sorted(files):
+                    if name.endswith(extension):
+                        yield os.path.join(root, name)
+        else:
+            yield path
+
+
+# -- commands ----------------------------------------------------------------
+
+def cmd_vectors(args, out):
+    out.writerow(['run', 'module', 'name', 'unit', 'count', 'chunks'])
+    for path in find_files(args.paths, '.cvec'):
+        f = VectorFile(path)
+        for v in f.find(args.module, args.name):
+            out.writerow([f.run, v.module, v.name, v.attributes.get('unit', ''), v.count, len(v.chunks)])
+        f.close()
+
+
+def cmd_stats(args, out):
+    out.writerow(['run', 'module', 'name', 'count', 'mean', 'min', 'max', 'first', 'last'])
+    for path in find_files(args.paths, '.cvec'):
+        f = VectorFile(path)
+        for v in f.find(args.module, args.name):
+            n = v.count
+            out.writerow([f.run, v.module, v.name, n, v.sum / n if n else '',
+                          v.min, v.max,
+                          v.chunks[0].first_time * f.time_scale, v.chunks[-1].last_time * f.time_scale])
+        f.close()
+
+
+def cmd_scan(args, out):
+    header = ['run', 'module', 'name']
+    if args.column in ('time', 'both'):
+        header.append('time')
+    if args.column in ('value', 'both'):
+        header.append('value')
+    out.writerow(header)
+    for path in find_files(args.paths, '.cvec'):
+        f = VectorFile(path)
+        t0 = None if args.start is None else int(round(args.start / f.time_scale))
+        t1 = None if args.end is None else int(round(args.end / f.time_scale))
+        for v in f.find(args.module, args.name):
+            prefix = [f.run, v.module, v.name]
+            if args.column == 'time':
+                rows = ([t] for t in v.times(t0, t1))
+            elif args.column == 'value' and t0 is None and t1 is None:
+                rows = ([x] for x in v.values())
+            else:
+                pairs = v.samples(t0, t1)
+                rows = ([t, x] for t, x in pairs) if args.column == 'both' else ([x] for _, x in pairs)
+            for row in rows:
+                out.writerow(prefix + row)
+        f.close()
+
+
+def cmd_scalars(args, out):
+    out.writerow(['run', 'module', 'name', 'unit', 'value'])
+    for path in find_files(args.paths, '.csca'):
+        f = ScalarFile(path)
+        for module, name, value in f.scalars(args.module, args.name):
+            out.writerow([f.run, module, name, f.unit(module, name), value])
+        f.close()
+
+
+def cmd_histograms(args, out):
+    out.writerow(['run', 'module', 'name', 'lower', 'upper', 'count'])
+    for path in find_files(args.paths, '.csca'):
+        f = ScalarFile(path)
+        for (module, name), (edges, counts) in sorted(f.histograms.items()):
+            if not (matches(module, args.module) and matches(name, args.name)):
+                continue
+            bounds = [float('-inf')] + edges + [float('inf')]
+            for i, count in enumerate(counts):
+                out.writerow([f.run, module, name, bounds[i], bounds[i + 1], count])
+        f.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Reader of columnar OMNeT++ result files (.cvec, .csca)')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    def add_common(p):
+        p.add_argument('-m', '--module', default='*', help='module glob')
+        p.add_argument('-n', '--name', default='*', help='vector or scalar name glob')
+        p.add_argument('paths', nargs='+', help='result files or directories')
+
+    p = sub.add_parser('vectors', help='list vectors')
+    add_common(p)
+    p.set_defaults(func=cmd_vectors)
+
+    p = sub.add_parser('stats', help='count/mean/min/max per vector from the index')
+    add_common(p)
+    p.set_defaults(func=cmd_stats)
+
+    p = sub.add_parser('scan', help='decode vector samples')
+    add_common(p)
+    p.add_argument('--column', choices=['time', 'value', 'both'], default='both', help='columns to decode')
+    p.add_argument('--start', type=float, help='first simulation time (s)')
+    p.add_argument('--end', type=float, help='last simulation time (s)')
+    p.set_defaults(func=cmd_scan)
+
+    p = sub.add_parser('scalars', help='list scalars')
+    add_common(p)
+    p.set_defaults(func=cmd_scalars)
+
+    p = sub.add_parser('histograms', help='list histogram bins')
+    add_common(p)
+    p.set_defaults(func=cmd_histograms)
+
+    args = parser.parse_args()
+    out = csv.writer(sys.stdout, lineterminator='\n')
+    try:
+        args.func(args, out)
+    except BrokenPipeError:
+        pass
+    except ValueError as e:
+        sys.exit(str(e))
+
+
+if __name__ == '__main__':
+    main()
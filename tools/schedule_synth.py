@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+Offline schedule synthesizer for the in-vehicle network.
+
+Reads a topology description (nodes, links and the VL set) and computes,
+for every switch along the path of every VL, a receive window and a send
+window such that no two VLs overlap on any directed link over the
+hyperperiod. VLs are placed in rate-monotonic order (shortest period first)
+and each one takes the earliest free slot on every hop, which minimizes its
+end-to-end latency given the VLs already placed.
+
+The result is written as the <schedule> XML loaded by the ScheduleStore
+module (parameter staticSchedule). Switches covered by the schedule skip
+the runtime learn-and-reconfigure phase.
+
+Input format (all times in ticks, the unit of the window parameters):
+
+    <topology>
+        <node name="switch_1" type="switch"/>
+        <node name="freno" type="ecu"/>
+        <link from="freno" to="switch_1" txTicksPerByte="0.08" delay="1"/>
+        <vl id="214" source="freno" destination="tablero" bytes="64"
+            period="1000" sendWindowStart="0"/>
+    </topology>
+
+Links are full duplex. Optional attributes: <link processing="..."> adds the
+switch forwarding delay at the receiving side, <vl receiveMargin="..."> widens
+the receive window, <vl path="switch_2 switch_3"> forces the switch path
+(otherwise the shortest path is used). If sendWindowStart is omitted the
+synthesizer also picks the source ECU send slot.
+
+Usage:
+    schedule_synth.py topology.xml -o schedule.xml [--ini ecu_windows.ini]
+"""
+
+import argparse
+import math
+import sys
+import xml.etree.ElementTree as ET
+from collections import deque
+from functools import reduce
+
+
+def lcm(a, b):
+    return a * b // math.gcd(a, b)
+
+
+class Link:
+    def __init__(self, src, dst, ticks_per_byte, delay, processing):
+        self.src = src
+        self.dst = dst
+        self.ticks_per_byte = ticks_per_byte
+        self.delay = delay
+        self.processing = processing
+        self.busy = []      # reserved (start, end) intervals inside [0, hyperperiod)
+
+    def tx_ticks(self, nbytes):
+        return max(1, int(math.ceil(nbytes * self.ticks_per_byte)))
+
+
+class Topology:
+    def __init__(self, root):
+        self.nodes = {}
+        self.links = {}
+        self.neighbors = {}
+        for n in root.findall('node'):
+            self.nodes[n.get('name')] = n.get('type', 'ecu')
+            self.neighbors.setdefault(n.get('name'), [])
+        for l in root.findall('link'):
+            a, b = l.get('from'), l.get('to')
+            for name in (a, b):
+                if name not in self.nodes:
+                    raise SystemExit("link references unknown node '%s'" % name)
+            tpb = float(l.get('txTicksPerByte', '1'))
+            delay = int(l.get('delay', '0'))
+            processing = int(l.get('processing', '0'))
+            # full duplex: one reservation list per direction
+            self.links[(a, b)] = Link(a, b, tpb, delay, processing)
+            self.links[(b, a)] = Link(b, a, tpb, delay, processing)
+            self.neighbors[a].append(b)
+            self.neighbors[b].append(a)
+
+    def is_switch(self, name):
+        return self.nodes[name] == 'switch'
+
+    def shortest_path(self, src, dst):
+        prev = {src: None}
+        queue = deque([src])
+        while queue:
+            node = queue.popleft()
+            if node == dst:
+                break
+            for n in self.neighbors[node]:
+                # end stations do not forward
+                if n not in prev and (n == dst or self.is_switch(n)):
+                    prev[n] = node
+                    queue.append(n)
+        if dst not in prev:
+            raise SystemExit("no path from '%s' to '%s'" % (src, dst))
+        path = []
+        node = dst
+        while node is not None:
+            path.append(node)
+            node = prev[node]
+        return list(reversed(path))
+
+
+class VL:
+    def __init__(self, e):
+        self.id = int(e.get('id'))
+        self.source = e.get('source')
+        self.destination = e.get('destination')
+        self.bytes = int(e.get('bytes', '64'))
+        self.period = int(e.get('period'))
+        self.fixed_start = int(e.get('sendWindowStart')) if e.get('sendWindowStart') is not None else None
+        self.receive_margin = int(e.get('receiveMargin', '0'))
+        self.path = e.get('path').split() if e.get('path') else None
+
+
+def overlaps(busy, start, end, period, hyperperiod):
+    """Checks [start+k*period, end+k*period) against the reservations of a link."""
+    for k in range(hyperperiod // period):
+        s = (start + k * period) % hyperperiod
+        e = s + (end - start)
+        for bs, be in busy:
+            # reservations and candidates may wrap around the hyperperiod
+            for shift in (-hyperperiod, 0, hyperperiod):
+                if s < be + shift and bs + shift < e:
+                    return True
+    return False
+
+
+def reserve(link, start, end, period, hyperperiod):
+    for k in range(hyperperiod // period):
+        s = (start + k * period) % hyperperiod
+        link.busy.append((s, s + (end - start)))
+
+
+def earliest_slot(link, ready, duration, period, hyperperiod):
+    """Earliest start >= ready such that the link is free for duration ticks in every period."""
+    for start in range(ready, ready + period):
+        if not overlaps(link.busy, start, start + duration, period, hyperperiod):
+            return start
+    return None
+
+
+def synthesize(topo, vls):
+    hyperperiod = reduce(lcm, [vl.period for vl in vls], 1)
+    schedule = {}       # switch -> list of (vl id, windows dict)
+    ecu_windows = []    # (ecu, vl id, sendWindowStart, sendWindowEnd)
+    latencies = []
+
+    for vl in sorted(vls, key=lambda v: (v.period, v.id)):
+        if vl.path is not None:
+            path = [vl.source] + vl.path + [vl.destination]
+        else:
+            path = topo.shortest_path(vl.source, vl.destination)
+
+        # source ECU egress
+        first = topo.links.get((path[0], path[1]))
+        if first is None:
+            raise SystemExit("VL %d: no link %s -> %s" % (vl.id, path[0], path[1]))
+        duration = first.tx_ticks(vl.bytes)
+        if vl.fixed_start is not None:
+            start = vl.fixed_start
+            if overlaps(first.busy, start, start + duration, vl.period, hyperperiod):
+                raise SystemExit("VL %d: fixed sendWindowStart %d collides on %s -> %s"
+                                 % (vl.id, start, first.src, first.dst))
+        else:
+            start = earliest_slot(first, 0, duration, vl.period, hyperperiod)
+            if start is None:
+                raise SystemExit("VL %d: link %s -> %s is saturated" % (vl.id, first.src, first.dst))
+        reserve(first, start, start + duration, vl.period, hyperperiod)
+        ecu_windows.append((vl.source, vl.id, start, start + duration))
+
+        release = start
+        arrival_start = start + first.delay
+        arrival_end = arrival_start + duration
+        prev = first
+
+        for i in range(1, len(path) - 1):
+            switch = path[i]
+            out = topo.links[(switch, path[i + 1])]
+            receive_end = arrival_end + vl.receive_margin
+            ready = receive_end + prev.processing + 1
+            duration = out.tx_ticks(vl.bytes)
+            send_start = earliest_slot(out, ready, duration, vl.period, hyperperiod)
+            if send_start is None:
+                raise SystemExit("VL %d: link %s -> %s is saturated" % (vl.id, out.src, out.dst))
+            reserve(out, send_start, send_start + duration, vl.period, hyperperiod)
+
+            schedule.setdefault(switch, []).append((vl.id, {
+                'receiveWindowStart': arrival_start,
+                'receiveWindowEnd': receive_end,
+                'permanencePit': receive_end,
+                'sendWindowStart': send_start,
+                'sendWindowEnd': send_start + duration,
+            }))
+
+            arrival_start = send_start + out.delay
+            arrival_end = arrival_start + duration
+            prev = out
+
+        latencies.append((vl.id, arrival_end - release))
+
+    return hyperperiod, schedule, ecu_windows, latencies
+
+
+def write_schedule(path, hyperperiod, schedule):
+    root = ET.Element('schedule', {'hyperperiod': str(hyperperiod)})
+    for switch in sorted(schedule):
+        sw = ET.SubElement(root, 'switch', {'name': switch})
+        for vl_id, w in sorted(schedule[switch]):
+            attrs = {'id': str(vl_id)}
+            attrs.update((k, str(v)) for k, v in w.items())
+            ET.SubElement(sw, 'vl', attrs)
+    tree = ET.ElementTree(root)
+    if hasattr(ET, 'indent'):
+        ET.indent(tree)
+    tree.write(path, encoding='UTF-8', xml_declaration=True)
+
+
+def write_ini(path, ecu_windows):
+    with open(path, 'w', encoding='UTF-8') as f:
+        f.write('# source ECU send windows generated by schedule_synth.py\n')
+        for ecu, vl_id, start, end in sorted(ecu_windows):
+            f.write('**.%s.vl_%d.sendWindowStart = %d\n' % (ecu, vl_id, start))
+            f.write('**.%s.vl_%d.sendWindowEnd = %d\n' % (ecu, vl_id, end))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[1],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('topology', help='topology and VL set (XML)')
+    parser.add_argument('-o', '--output', default='schedule.xml', help='schedule XML for ScheduleStore.staticSchedule')
+    parser.add_argument('--ini', help='also write the source ECU send windows as ini entries')
+    args = parser.parse_args()
+
+    root = ET.parse(args.topology).getroot()
+    topo = Topology(root)
+    vls = [VL(e) for e in root.findall('vl')]
+    if not vls:
+        raise SystemExit('no VLs in %s' % args.topology)
+
+    hyperperiod, schedule, ecu_windows, latencies = synthesize(topo, vls)
+    write_schedule(args.output, hyperperiod, schedule)
+    if args.ini:
+        write_ini(args.ini, ecu_windows)
+
+    sys.stderr.write('hyperperiod: %d ticks, %d VLs, %d switches\n' % (hyperperiod, len(vls), len(schedule)))
+    for vl_id, latency in sorted(latencies):
+        sys.stderr.write('  vl_%d: end-to-end latency %d ticks\n' % (vl_id, latency))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+"""
+Multi-core replication and parameter-sweep runner for the in-vehicle network.
+
+Runs all runs of an ini configuration (repetitions x iteration variables,
+as expanded by OMNeT++) on every core of the machine, headless in Cmdenv
+express mode. As each run finishes its scalar file is parsed and streamed
+into one SQLite store, so the recordScalar() results of the relays, MACs,
+ScheduleStores and traffic modules of every run end up in a single place:
+
+  <out>/jobs.jsonl    job log, one line per finished run (resumable)
+  <out>/sca/          scalar file of every run
+  <out>/results.db    runs(run, config, runId, variant, repetition)
+                      scalars(run, module, name, value)
+  <out>/summary.csv   per variant, module and scalar: n, mean, stddev and
+                      the confidence interval of the mean over repetitions
+
+A variant is one combination of iteration variables ($iterationvars); its
+repetitions (different seeds) are the samples of the confidence interval.
+
+Re-running the same command resumes the study: runs logged as finished are
+not run again. --retry-failed also reruns the failed ones, --aggregate-only
+only rebuilds the summary.
+
+Example:
+    sweep_runner.py -f ../simulations/omnetpp.ini -c WindowOffsets \\
+        --command ../in_vehicle_detnet -o sweeps/offsets -j 16
+"""
+
+import argparse
+import csv
+import fnmatch
+import json
+import math
+import os
+import re
+import sqlite3
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+COMMON_OPTIONS = [
+    '-u', 'Cmdenv',
+    '--cmdenv-express-mode=true',
+    '--cmdenv-performance-display=false',
+    '--record-eventlog=false',
+    '--**.hotPathLogging=false',
+]
+
+
+# -- Student t quantile (no scipy dependency) -------------------------------
+
+def _betacf(a, b, x):
+    """Continued fraction of the regularized incomplete beta function."""
+    tiny = 1e-300
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def _betainc(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * _betacf(a, b, x) / a
+    return 1.0 - front * _betacf(b, a, 1.0 - x) / b
+
+
+def t_cdf(t, df):
+    x = df / (df + t * t)
+    tail = 0.5 * _betainc(df / 2.0, 0.5, x)
+    return 1.0 - tail if t > 0 else tail
+
+
+def t_quantile(p, df):
+    lo, hi = 0.0, 1e3
+    for _ in range(200):
+        mid = (lo + hi) / 2.0
+        if t_cdf(mid, df) < p:
+            lo = mid
+        else:
+            hi = mid
+    return (lo + hi) / 2.0
+
+
+# -- scalar files and the result store --------------------------------------
+
+def parse_sca(path):
+    """Returns (attributes, [(module, name, value)]) of an OMNeT++ scalar file."""
+    attrs = {}
+    scalars = []
+    attr = re.compile(r'^attr\s+(\S+)\s+(.*)$')
+    scalar = re.compile(r'^scalar\s+(\S+)\s+("(?:[^"\\]|\\.)*"|\S+)\s+(\S+)')
+    with open(path, encoding='UTF-8', errors='replace') as f:
+        for line in f:
+            if line.startswith('run '):
+                attrs['runId'] = line.split(None, 1)[1].strip()
+                continue
+            m = attr.match(line)
+            if m:
+                attrs.setdefault(m.group(1), m.group(2).strip().strip('"'))
+                continue
+            m = scalar.match(line)
+            if m:
+                try:
+                    value = float(m.group(3))
+                except ValueError:
+                    continue
+                scalars.append((m.group(1), m.group(2).strip('"'), value))
+    return attrs, scalars
+
+
+def open_store(path):
+    db = sqlite3.connect(path, check_same_thread=False)
+    db.executescript('''
+        CREATE TABLE IF NOT EXISTS runs (
+            run INTEGER PRIMARY KEY, config TEXT, runId TEXT, variant TEXT, repetition INTEGER);
+        CREATE TABLE IF NOT EXISTS scalars (
+            run INTEGER, module TEXT, name TEXT, value REAL);
+        CREATE INDEX IF NOT EXISTS scalars_run ON scalars(run);
+    ''')
+    return db
+
+
+def store_run(db, run, config, sca):
+    attrs, scalars = parse_sca(sca)
+    variant = attrs.get('iterationvars', '')
+    repetition = int(attrs.get('repetition', '0') or 0)
+    with db:
+        db.execute('DELETE FROM scalars WHERE run = ?', (run,))
+        db.execute('INSERT OR REPLACE INTO runs VALUES (?, ?, ?, ?, ?)',
+                   (run, config, attrs.get('runId', ''), variant, repetition))
+        db.executemany('INSERT INTO scalars VALUES (?, ?, ?, ?)',
+                       [(run, module, name, value) for module, name, value in scalars])
+    return len(scalars)
+
+
+def summarize(db, out_csv, confidence, module_filter, name_filter):
+    groups = {}
+    rows = db.execute('SELECT r.variant, s.module, s.name, s.value FROM scalars s JOIN runs r ON r.run = s.run')
+    for variant, module, name, value in rows:
+        if module_filter and not fnmatch.fnmatchcase(module, module_filter):
+            continue
+        if name_filter and not fnmatch.fnmatchcase(name, name_filter):
+            continue
+        groups.setdefault((variant, module, name), []).append(value)
+
+    quantiles = {}
+    with open(out_csv, 'w', newline='', encoding='UTF-8') as f:
+        w = csv.writer(f)
+        w.writerow(['variant', 'module', 'name', 'n', 'mean', 'stddev', 'ciLow', 'ciHigh'])
+        for (variant, module, name) in sorted(groups):
+            values = groups[(variant, module, name)]
+            n = len(values)
+            mean = sum(values) / n
+            if n > 1:
+                stddev = math.sqrt(sum((v - mean) ** 2 for v in values) / (n - 1))
+                if n - 1 not in quantiles:
+                    quantiles[n - 1] = t_quantile(0.5 + confidence / 2.0, n - 1)
+                half = quantiles[n - 1] * stddev / math.sqrt(n)
+            else:
+                stddev = half = float('nan')
+            w.writerow([variant, module, name, n, repr(mean), repr(stddev), repr(mean - half), repr(mean + half)])
+    return len(groups)
+
+
+# -- job log ----------------------------------------------------------------
+
+def read_job_log(path):
+    done, failed = set(), set()
+    if os.path.exists(path):
+        with open(path, encoding='UTF-8') as f:
+            for line in f:
+                try:
+                    job = json.loads(line)
+                except ValueError:
+                    continue    # line cut short by an interrupted runner
+                if job.get('status') == 'ok':
+                    done.add(job['run'])
+                    failed.discard(job['run'])
+                else:
+                    failed.add(job['run'])
+    return done, failed - done
+
+
+def count_runs(args):
+    cmd = [args.command, '-f', args.ini, '-x', args.config, '-q', 'numruns'] + args.option
+    output = subprocess.check_output(cmd, cwd=args.workdir, universal_newlines=True, stderr=subprocess.STDOUT)
+    numbers = re.findall(r'(\d+)\s*$', output.strip())
+    if not numbers:
+        raise SystemExit('could not get the number of runs of %s from:\n%s' % (args.config, output))
+    return int(numbers[-1])
+
+
+def parse_runs(spec, total):
+    runs = set()
+    for part in spec.split(','):
+        if '..' in part:
+            a, b = part.split('..')
+            runs.update(range(int(a or 0), int(b) + 1 if b else total))
+        else:
+            runs.add(int(part))
+    return sorted(r for r in runs if r < total)
+
+
+def run_one(args, run, sca):
+    if os.path.exists(sca):
+        os.remove(sca)
+    cmd = [args.command, '-f', args.ini, '-c', args.config, '-r', str(run),
+           '--output-scalar-file=%s' % sca] + COMMON_OPTIONS
+    if not args.vectors:
+        cmd.append('--**.vector-recording=false')
+    cmd += args.option
+    start = time.time()
+    proc = subprocess.run(cmd, cwd=args.workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    wall = time.time() - start
+    tail = proc.stdout.strip().splitlines()[-5:] if proc.returncode != 0 else []
+    return proc.returncode, wall, tail
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Parallel replication and parameter-sweep runner')
+    parser.add_argument('-f', '--ini', required=True, help='ini file')
+    parser.add_argument('-c', '--config', required=True, help='configuration to run')
+    parser.add_argument('--command', default='../in_vehicle_detnet', help='simulation executable (or opp_run)')
+    parser.add_argument('--workdir', default='.', help='working directory of the simulations')
+    parser.add_argument('-o', '--output', required=True, help='study directory')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1, help='parallel runs')
+    parser.add_argument('--runs', help='runs to execute, e.g. "0..99,150" (default: all)')
+    parser.add_argument('--option', action='append', default=[], help='extra simulation option (repeatable)')
+    parser.add_argument('--vectors', action='store_true', help='keep vector recording enabled')
+    parser.add_argument('--confidence', type=float, default=0.95, help='confidence level of the intervals')
+    parser.add_argument('--module', help='only summarize modules matching this glob')
+    parser.add_argument('--scalar', help='only summarize scalars matching this glob')
+    parser.add_argument('--retry-failed', action='store_true', help='rerun the runs logged as failed')
+    parser.add_argument('--aggregate-only', action='store_true', help='do not run, only rebuild the summary')
+    args = parser.parse_args()
+
+    args.command = os.path.abspath(args.command) if os.path.sep in args.command else args.command
+    args.ini = os.path.abspath(args.ini)
+    out = os.path.abspath(args.output)
+    os.makedirs(os.path.join(out, 'sca'), exist_ok=True)
+    log_path = os.path.join(out, 'jobs.jsonl')
+    db = open_store(os.path.join(out, 'results.db'))
+
+    if not args.aggregate_only:
+        total = count_runs(args)
+        runs = parse_runs(args.runs, total) if args.runs else list(range(total))
+        done, failed = read_job_log(log_path)
+        pending = [r for r in runs if r not in done and (args.retry_failed or r not in failed)]
+        sys.stderr.write('%s: %d runs, %d already done, %d failed before, %d to run on %d cores\n'
+                         % (args.config, len(runs), len(done & set(runs)), len(failed & set(runs)),
+                            len(pending), args.jobs))
+
+        lock = threading.Lock()
+        finished = 0
+        start = time.time()
+        with open(log_path, 'a', encoding='UTF-8') as log, ThreadPoolExecutor(max_workers=args.jobs) as pool:
+            futures = {}
+            for run in pending:
+                sca = os.path.join(out, 'sca', '%s-%d.sca' % (args.config, run))
+                futures[pool.submit(run_one, args, run, sca)] = (run, sca)
+            for future in as_completed(futures):
+                run, sca = futures[future]
+                returncode, wall, tail = future.result()
+                status = 'ok' if returncode == 0 and os.path.exists(sca) else 'failed'
+                nscalars = store_run(db, run, args.config, sca) if status == 'ok' else 0
+                with lock:
+                    log.write(json.dumps({'run': run, 'status': status, 'returncode': returncode,
+                                          'wallTime': round(wall, 3), 'scalars': nscalars}) + '\n')
+                    log.flush()
+                    finished += 1
+                if status != 'ok':
+                    sys.stderr.write('\nrun %d failed (%d):\n    %s\n' % (run, returncode, '\n    '.join(tail)))
+                elapsed = time.time() - start
+                eta = elapsed / finished * (len(pending) - finished)
+                sys.stderr.write('\r%d/%d runs, %.0f s elapsed, ~%.0f s left ' % (finished, len(pending), elapsed, eta))
+        if pending:
+            sys.stderr.write('\n')
+
+    ngroups = summarize(db, os.path.join(out, 'summary.csv'), args.confidence, args.module, args.scalar)
+    nruns = db.execute('SELECT COUNT(*) FROM runs').fetchone()[0]
+    print('%d runs in %s, %d scalar groups summarized (%.0f%% confidence) in %s'
+          % (nruns, os.path.join(out, 'results.db'), ngroups, 100 * args.confidence, os.path.join(out, 'summary.csv')))
+
+    done, failed = read_job_log(log_path)
+    if failed:
+        raise SystemExit('%d runs failed, rerun with --retry-failed' % len(failed))
+
+
+if __name__ == '__main__':
+    main()
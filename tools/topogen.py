@@ -0,0 +1,338 @@
+#!/usr/bin/env python3
+"""
+Parametric topology generator for scaling studies of the in-vehicle network.
+
+Generates an N-switch, M-ECU, K-VL vehicle network in one of four shapes:
+
+  chain   switch_1 - switch_2 - ... - switch_N
+  ring    chain closed back to switch_1 (needs STP/RSTP in the switches)
+  star    switch_1 in the centre, every other switch attached to it
+  zonal   switch_1 as central gateway without ECUs, zone switches
+          switch_2..switch_N attached to it, ECUs only on the zones
+
+together with everything the switch agent and the traffic management module
+need to run it:
+
+  <out>/<Network>.ned     network with switches, ECUs and the management node
+  <out>/vlconfig.xml      VL table of the switches (EtherMACFullDuplex.vlConfig)
+  <out>/configroutes.xml  forwarding of configurations in the management node
+                          (EtherTrafGen.configRoutes)
+  <out>/topology.xml      input for tools/schedule_synth.py
+  <out>/omnetpp.ini       [Config Scaled] wiring the files above, and
+                          [Config ScaledParallel] running it as a parallel
+                          simulation with one partition per switch domain
+
+The generated NED declares the VL modules explicitly. Every switch with VLs
+gets its own module type, <Network>Switch<i>, that extends --switch-type
+with a vl_<id> (--vl-type) and a vl_<id>_ctc (--vl-ctc-type) submodule per
+VL it forwards; every ECU that sources VLs gets <Network>Ecu<j>, extending
+--ecu-type with a vl_<id> (--vl-type) per VL. These are the submodules
+VLTable and ScheduleStore look up by name. The VL submodules are not
+connected: the derived types allow unconnected gates.
+
+The base types are NOT generated and must exist in the NED path of the
+simulation project (import them with --imports if they are in a package):
+
+  --switch-type   switch with relay, appControl and scheduleStore, no VLs
+  --ecu-type      ECU without VLs
+  --manager-type  management node with in[] / out[] gate vectors
+  --vl-type       VL send module (sendWindowStart, sendWindowEnd)
+  --vl-ctc-type   VL receive module (receive_window_start, receive_window_end,
+                  permanence_pit)
+
+The window parameters of the VL modules need defaults; the generated NED
+does not set them. The management node is connected to switch_i through
+in[i-1] / out[i-1].
+
+In ScaledParallel every switch forms a partition with the ECUs attached to it
+(--partitions groups several switch domains per partition); the management
+node runs in partition 0. The link delays are the lookahead of the null
+message protocol, so the management connections get the managementDelay
+network parameter, which must be positive in that configuration.
+
+Example:
+    topogen.py --switches 20 --ecus 100 --vls 400 --shape zonal -o generated/scaled_20
+"""
+
+import argparse
+import os
+import random
+import sys
+from collections import deque
+
+# the id range accepted by the ScheduleStore (SCHEDULE_MAX_VLS)
+FIRST_VL_ID = 100
+MAX_VL_ID = 1023
+
+# window offset added by the management node per extra hop (see configroutes.xml)
+HOP_OFFSET = 21
+
+
+def switch_links(n, shape):
+    if shape == 'chain':
+        return [(i, i + 1) for i in range(1, n)]
+    if shape == 'ring':
+        links = [(i, i + 1) for i in range(1, n)]
+        if n > 2:
+            links.append((n, 1))
+        return links
+    if shape in ('star', 'zonal'):
+        return [(1, i) for i in range(2, n + 1)]
+    raise SystemExit('unknown shape: %s' % shape)
+
+
+def hop_counts(n, links):
+    neighbors = dict((i, []) for i in range(1, n + 1))
+    for a, b in links:
+        neighbors[a].append(b)
+        neighbors[b].append(a)
+    hops = {}
+    for src in range(1, n + 1):
+        dist = {src: 0}
+        queue = deque([src])
+        while queue:
+            node = queue.popleft()
+            for nb in neighbors[node]:
+                if nb not in dist:
+                    dist[nb] = dist[node] + 1
+                    queue.append(nb)
+        hops[src] = dist
+    return hops, neighbors
+
+
+def switch_path(neighbors, src, dst):
+    prev = {src: None}
+    queue = deque([src])
+    while queue:
+        node = queue.popleft()
+        if node == dst:
+            break
+        for nb in neighbors[node]:
+            if nb not in prev:
+                prev[nb] = node
+                queue.append(nb)
+    path = []
+    node = dst
+    while node is not None:
+        path.append(node)
+        node = prev[node]
+    return list(reversed(path))
+
+
+def generate(args):
+    n, m, k = args.switches, args.ecus, args.vls
+    if n < 1 or m < 2 or k < 1:
+        raise SystemExit('need at least 1 switch, 2 ECUs and 1 VL')
+    if FIRST_VL_ID + k - 1 > MAX_VL_ID:
+        raise SystemExit('at most %d VLs are supported' % (MAX_VL_ID - FIRST_VL_ID + 1))
+    if args.shape == 'zonal' and n < 2:
+        raise SystemExit('the zonal shape needs at least 2 switches')
+
+    rng = random.Random(args.seed)
+    links = switch_links(n, args.shape)
+    hops, neighbors = hop_counts(n, links)
+
+    edge_switches = list(range(2, n + 1)) if args.shape == 'zonal' else list(range(1, n + 1))
+    ecus = ['ecu_%d' % i for i in range(1, m + 1)]
+    ecu_switch = dict((ecu, edge_switches[i % len(edge_switches)]) for i, ecu in enumerate(ecus))
+
+    vls = []
+    for i in range(k):
+        vl_id = FIRST_VL_ID + i
+        src, dst = rng.sample(ecus, 2)
+        path = switch_path(neighbors, ecu_switch[src], ecu_switch[dst])
+        period = rng.choice(args.periods)
+        vls.append({'id': vl_id, 'source': src, 'destination': dst, 'path': path, 'period': period})
+
+    switch_vls = dict((s, []) for s in range(1, n + 1))
+    ecu_vls = dict((e, []) for e in ecus)
+    for vl in vls:
+        ecu_vls[vl['source']].append(vl['id'])
+        for s in vl['path']:
+            switch_vls[s].append(vl['id'])
+
+    os.makedirs(args.output, exist_ok=True)
+    write_ned(args, n, links, ecus, ecu_switch, switch_vls, ecu_vls)
+    write_vlconfig(args, vls)
+    write_configroutes(args, n, hops)
+    write_topology(args, n, links, ecus, ecu_switch, vls)
+    write_ini(args, ecus, ecu_switch)
+
+    sys.stderr.write('%s: %d switches (%s), %d ECUs, %d VLs, %d switch links\n'
+                     % (args.output, n, args.shape, m, k, len(links)))
+
+
+def vl_module_type(lines, name, base, submodules):
+    """Module type extending base with the given (name, type) submodules."""
+    lines += ['module %s extends %s' % (name, base), '{', '    submodules:']
+    for sub, sub_type in submodules:
+        lines.append('        %s: %s;' % (sub, sub_type))
+    lines += ['    connections allowunconnected:', '}', '']
+
+
+def write_ned(args, n, links, ecus, ecu_switch, switch_vls, ecu_vls):
+    lines = ['//', '// Generated by tools/topogen.py -- do not edit', '//', '']
+    for imp in args.imports:
+        lines.append('import %s;' % imp)
+    if args.imports:
+        lines.append('')
+
+    # one concrete type per node with VLs, with its vl_<id> / vl_<id>_ctc submodules
+    switch_types = {}
+    for s in range(1, n + 1):
+        switch_types[s] = args.switch_type
+        if switch_vls[s]:
+            switch_types[s] = '%sSwitch%d' % (args.network, s)
+            submodules = []
+            for v in switch_vls[s]:
+                submodules += [('vl_%d' % v, args.vl_type), ('vl_%d_ctc' % v, args.vl_ctc_type)]
+            vl_module_type(lines, switch_types[s], args.switch_type, submodules)
+    ecu_types = {}
+    for j, ecu in enumerate(ecus, 1):
+        ecu_types[ecu] = args.ecu_type
+        if ecu_vls[ecu]:
+            ecu_types[ecu] = '%sEcu%d' % (args.network, j)
+            vl_module_type(lines, ecu_types[ecu], args.ecu_type, [('vl_%d' % v, args.vl_type) for v in ecu_vls[ecu]])
+
+    lines += ['network %s' % args.network, '{',
+              '    parameters:',
+              '        double managementDelay @unit(s) = default(0s);',
+              '    submodules:']
+    for s in range(1, n + 1):
+        lines.append('        switch_%d: %s;' % (s, switch_types[s]))
+    for ecu in ecus:
+        lines.append('        %s: %s;' % (ecu, ecu_types[ecu]))
+    lines.append('        poolStatistics: ObjectPoolStatistics;')
+    lines.append('        gestor: %s {' % args.manager_type)
+    lines.append('            gates:')
+    lines.append('                in[%d];' % n)
+    lines.append('                out[%d];' % n)
+    lines.append('        }')
+    lines.append('    connections:')
+    for a, b in links:
+        lines.append('        switch_%d.ethg++ <--> %s <--> switch_%d.ethg++;' % (a, args.channel, b))
+    for ecu in ecus:
+        lines.append('        %s.ethg++ <--> %s <--> switch_%d.ethg++;' % (ecu, args.channel, ecu_switch[ecu]))
+    for s in range(1, n + 1):
+        lines.append('        gestor.out[%d] --> { delay = managementDelay; } --> switch_%d.management++;' % (s - 1, s))
+        lines.append('        switch_%d.managementOut++ --> { delay = managementDelay; } --> gestor.in[%d];' % (s, s - 1))
+    lines.append('}')
+    with open(os.path.join(args.output, '%s.ned' % args.network), 'w', encoding='UTF-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def write_vlconfig(args, vls):
+    # the first switch of the path detects the VL and informs appControl;
+    # the rest of the switches receive the configuration from the management node
+    by_switch = {}
+    for vl in vls:
+        by_switch.setdefault(vl['path'][0], []).append(vl)
+    lines = ['<?xml version="1.0" encoding="UTF-8"?>', '<!-- Generated by tools/topogen.py -->', '<vlconfig>']
+    for s in sorted(by_switch):
+        lines.append('    <switch name="switch_%d">' % s)
+        for vl in by_switch[s]:
+            lines.append('        <vl id="%d" source="%s" notify="true"/>' % (vl['id'], vl['source']))
+        lines.append('    </switch>')
+    lines.append('</vlconfig>')
+    with open(os.path.join(args.output, 'vlconfig.xml'), 'w', encoding='UTF-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def write_configroutes(args, n, hops):
+    lines = ['<?xml version="1.0" encoding="UTF-8"?>', '<!-- Generated by tools/topogen.py -->', '<routes>']
+    for s in range(1, n + 1):
+        others = [t for t in range(1, n + 1) if t != s and t in hops[s]]
+        if not others:
+            continue
+        lines.append('    <route in="%d">' % (s - 1))
+        for t in others:
+            offset = HOP_OFFSET * (hops[s][t] - 1)
+            lines.append('        <out gate="%d" hopOffset="%d"/>' % (t - 1, offset))
+        lines.append('    </route>')
+    lines.append('</routes>')
+    with open(os.path.join(args.output, 'configroutes.xml'), 'w', encoding='UTF-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def write_topology(args, n, links, ecus, ecu_switch, vls):
+    tpb = 8.0 / args.datarate_mbps     # ticks (us) per byte
+    lines = ['<?xml version="1.0" encoding="UTF-8"?>', '<!-- Generated by tools/topogen.py -->', '<topology>']
+    for s in range(1, n + 1):
+        lines.append('    <node name="switch_%d" type="switch"/>' % s)
+    for ecu in ecus:
+        lines.append('    <node name="%s" type="ecu"/>' % ecu)
+    for a, b in links:
+        lines.append('    <link from="switch_%d" to="switch_%d" txTicksPerByte="%g" delay="1" processing="1"/>' % (a, b, tpb))
+    for ecu in ecus:
+        lines.append('    <link from="%s" to="switch_%d" txTicksPerByte="%g" delay="1" processing="1"/>' % (ecu, ecu_switch[ecu], tpb))
+    for vl in vls:
+        lines.append('    <vl id="%d" source="%s" destination="%s" bytes="%d" period="%d" path="%s"/>'
+                     % (vl['id'], vl['source'], vl['destination'], args.frame_bytes, vl['period'],
+                        ' '.join('switch_%d' % s for s in vl['path'])))
+    lines.append('</topology>')
+    with open(os.path.join(args.output, 'topology.xml'), 'w', encoding='UTF-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def write_ini(args, ecus, ecu_switch):
+    partitions = min(args.partitions or args.switches, args.switches)
+    lines = [
+        '# Generated by tools/topogen.py',
+        '[Config Scaled]',
+        'description = "%d switches (%s), %d ECUs, %d VLs"' % (args.switches, args.shape, args.ecus, args.vls),
+        'network = %s' % args.network,
+        '**.vlConfig = xmldoc("vlconfig.xml")',
+        '**.gestor.**.configRoutes = xmldoc("configroutes.xml")',
+        '',
+        '[Config ScaledParallel]',
+        'extends = Scaled',
+        'description = "Scaled, %d partitions"' % partitions,
+        'parallel-simulation = true',
+        'parsim-communications-class = "%s"' % args.parsim_communications,
+        'parsim-synchronization-class = "cNullMessageProtocol"',
+        '*.managementDelay = %s' % args.management_delay,
+        '*.gestor.partition-id = 0',
+    ]
+    # consecutive switch domains share a partition, which keeps most links inside it
+    def partition(s):
+        return (s - 1) * partitions // args.switches
+    for s in range(1, args.switches + 1):
+        lines.append('*.switch_%d.partition-id = %d' % (s, partition(s)))
+    for ecu in ecus:
+        lines.append('*.%s.partition-id = %d' % (ecu, partition(ecu_switch[ecu])))
+    with open(os.path.join(args.output, 'omnetpp.ini'), 'w', encoding='UTF-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='In-vehicle network topology generator')
+    parser.add_argument('--switches', type=int, default=3, help='number of switches (N)')
+    parser.add_argument('--ecus', type=int, default=12, help='number of ECUs (M)')
+    parser.add_argument('--vls', type=int, default=20, help='number of VLs (K)')
+    parser.add_argument('--shape', choices=['chain', 'ring', 'star', 'zonal'], default='chain')
+    parser.add_argument('--seed', type=int, default=1, help='seed for VL endpoints and periods')
+    parser.add_argument('--periods', type=int, nargs='+', default=[1000, 2000, 5000],
+                        help='VL periods in ticks, chosen at random per VL')
+    parser.add_argument('--frame-bytes', type=int, default=64, help='VL frame size for the synthesizer')
+    parser.add_argument('--datarate-mbps', type=float, default=100.0, help='link datarate for the synthesizer')
+    parser.add_argument('--network', default='ScaledVehicle', help='NED network name')
+    parser.add_argument('--switch-type', default='VehicleSwitch', help='NED base type of the switches, without VLs')
+    parser.add_argument('--ecu-type', default='VehicleEcu', help='NED base type of the ECUs, without VLs')
+    parser.add_argument('--manager-type', default='TrafficManager', help='NED type of the management node')
+    parser.add_argument('--vl-type', default='VLSend', help='NED type of the vl_<id> modules')
+    parser.add_argument('--vl-ctc-type', default='VLReceive', help='NED type of the vl_<id>_ctc modules')
+    parser.add_argument('--channel', default='Eth100M', help='NED channel type of the links')
+    parser.add_argument('--imports', nargs='*', default=['inet.nodes.ethernet.Eth100M'],
+                        help='NED imports of the generated network')
+    parser.add_argument('--partitions', type=int, default=0,
+                        help='partitions of ScaledParallel (default: one per switch)')
+    parser.add_argument('--parsim-communications', default='cNamedPipeCommunications',
+                        help='parsim communications class of ScaledParallel')
+    parser.add_argument('--management-delay', default='1us',
+                        help='delay of the management connections in ScaledParallel (lookahead)')
+    parser.add_argument('-o', '--output', required=True, help='output directory')
+    generate(parser.parse_args())
+
+
+if __name__ == '__main__':
+    main()